@@ -81,6 +81,17 @@ before including blendish.h, otherwise the file will be in header-only mode.
 #define BND_EXPORT
 #endif
 
+// you can override these from the outside to trace the widget drawing calls;
+// BND_TRACE_BEGIN is passed the function name as string literal, e.g.
+// #define BND_TRACE_BEGIN(name) uiTraceBegin(name)
+// #define BND_TRACE_END() uiTraceEnd()
+#ifndef BND_TRACE_BEGIN
+#define BND_TRACE_BEGIN(name)
+#endif
+#ifndef BND_TRACE_END
+#define BND_TRACE_END()
+#endif
+
 // if that typedef is provided elsewhere, you may define
 // BLENDISH_NO_NVG_TYPEDEFS before including the header.
 #ifndef BLENDISH_NO_NVG_TYPEDEFS
@@ -1430,6 +1441,7 @@ void bndLabel(NVGcontext *ctx,
 void bndToolButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *label) {
+    BND_TRACE_BEGIN("bndToolButton");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1442,11 +1454,13 @@ void bndToolButton(NVGcontext *ctx,
     bndIconLabelValue(ctx,x,y,w,h,iconid,
         bndTextColor(&bnd_theme.toolTheme, state), BND_CENTER,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_TRACE_END();
 }
 
 void bndRadioButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *label) {
+    BND_TRACE_BEGIN("bndRadioButton");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1459,6 +1473,7 @@ void bndRadioButton(NVGcontext *ctx,
     bndIconLabelValue(ctx,x,y,w,h,iconid,
         bndTextColor(&bnd_theme.radioTheme, state), BND_CENTER,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_TRACE_END();
 }
 
 int bndTextFieldTextPosition(NVGcontext *ctx, float x, float y, float w, float h,
@@ -1470,6 +1485,7 @@ int bndTextFieldTextPosition(NVGcontext *ctx, float x, float y, float w, float h
 void bndTextField(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *text, int cbegin, int cend) {
+    BND_TRACE_BEGIN("bndTextField");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1485,11 +1501,13 @@ void bndTextField(NVGcontext *ctx,
     bndIconLabelCaret(ctx,x,y,w,h,iconid,
         bndTextColor(&bnd_theme.textFieldTheme, state), BND_LABEL_FONT_SIZE,
         text, bnd_theme.textFieldTheme.itemColor, cbegin, cend);
+    BND_TRACE_END();
 }
 
 void bndOptionButton(NVGcontext *ctx,
     float x, float y, float w, float h, BNDwidgetState state,
     const char *label) {
+    BND_TRACE_BEGIN("bndOptionButton");
     float ox, oy;
     NVGcolor shade_top, shade_down;
 
@@ -1514,11 +1532,13 @@ void bndOptionButton(NVGcontext *ctx,
     bndIconLabelValue(ctx,x+12,y,w-12,h,-1,
         bndTextColor(&bnd_theme.optionTheme, state), BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_TRACE_END();
 }
 
 void bndChoiceButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     int iconid, const char *label) {
+    BND_TRACE_BEGIN("bndChoiceButton");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1533,21 +1553,25 @@ void bndChoiceButton(NVGcontext *ctx,
         BND_LABEL_FONT_SIZE, label, NULL);
     bndUpDownArrow(ctx,x+w-10,y+10,5,
         bndTransparent(bnd_theme.choiceTheme.itemColor));
+    BND_TRACE_END();
 }
 
 void bndColorButton(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, NVGcolor color) {
+    BND_TRACE_BEGIN("bndColorButton");
     float cr[4];
     bndSelectCorners(cr, BND_TOOL_RADIUS, flags);
     bndBevelInset(ctx,x,y,w,h,cr[2],cr[3]);
     bndInnerBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3], color, color);
     bndOutlineBox(ctx,x,y,w,h,cr[0],cr[1],cr[2],cr[3],
         bndTransparent(bnd_theme.toolTheme.outlineColor));
+    BND_TRACE_END();
 }
 
 void bndNumberField(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     const char *label, const char *value) {
+    BND_TRACE_BEGIN("bndNumberField");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1564,11 +1588,13 @@ void bndNumberField(NVGcontext *ctx,
         bndTransparent(bnd_theme.numberFieldTheme.itemColor));
     bndArrow(ctx,x+w-8,y+10,BND_NUMBER_ARROW_SIZE,
         bndTransparent(bnd_theme.numberFieldTheme.itemColor));
+    BND_TRACE_END();
 }
 
 void bndSlider(NVGcontext *ctx,
     float x, float y, float w, float h, int flags, BNDwidgetState state,
     float progress, const char *label, const char *value) {
+    BND_TRACE_BEGIN("bndSlider");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1597,11 +1623,13 @@ void bndSlider(NVGcontext *ctx,
     bndIconLabelValue(ctx,x,y,w,h,-1,
         bndTextColor(&bnd_theme.sliderTheme, state), BND_CENTER,
         BND_LABEL_FONT_SIZE, label, value);
+    BND_TRACE_END();
 }
 
 void bndScrollBar(NVGcontext *ctx,
     float x, float y, float w, float h, BNDwidgetState state,
     float offset, float size) {
+    BND_TRACE_BEGIN("bndScrollBar");
 
     bndBevelInset(ctx,x,y,w,h,
         BND_SCROLLBAR_RADIUS, BND_SCROLLBAR_RADIUS);
@@ -1634,10 +1662,12 @@ void bndScrollBar(NVGcontext *ctx,
         BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
         BND_SCROLLBAR_RADIUS,BND_SCROLLBAR_RADIUS,
         bndTransparent(bnd_theme.scrollBarTheme.outlineColor));
+    BND_TRACE_END();
 }
 
 void bndMenuBackground(NVGcontext *ctx,
     float x, float y, float w, float h, int flags) {
+    BND_TRACE_BEGIN("bndMenuBackground");
     float cr[4];
     NVGcolor shade_top, shade_down;
 
@@ -1649,9 +1679,11 @@ void bndMenuBackground(NVGcontext *ctx,
         bndTransparent(bnd_theme.menuTheme.outlineColor));
     bndDropShadow(ctx,x,y,w,h,BND_MENU_RADIUS,
         BND_SHADOW_FEATHER,BND_SHADOW_ALPHA);
+    BND_TRACE_END();
 }
 
 void bndTooltipBackground(NVGcontext *ctx, float x, float y, float w, float h) {
+    BND_TRACE_BEGIN("bndTooltipBackground");
     NVGcolor shade_top, shade_down;
 
     bndInnerColors(&shade_top, &shade_down, &bnd_theme.tooltipTheme,
@@ -1664,6 +1696,7 @@ void bndTooltipBackground(NVGcontext *ctx, float x, float y, float w, float h) {
         bndTransparent(bnd_theme.tooltipTheme.outlineColor));
     bndDropShadow(ctx,x,y,w,h,BND_MENU_RADIUS,
         BND_SHADOW_FEATHER,BND_SHADOW_ALPHA);
+    BND_TRACE_END();
 }
 
 void bndMenuLabel(NVGcontext *ctx,
@@ -1676,6 +1709,7 @@ void bndMenuLabel(NVGcontext *ctx,
 void bndMenuItem(NVGcontext *ctx,
     float x, float y, float w, float h, BNDwidgetState state,
     int iconid, const char *label) {
+    BND_TRACE_BEGIN("bndMenuItem");
     if (state != BND_DEFAULT) {
         bndInnerBox(ctx,x,y,w,h,0,0,0,0,
             bndOffsetColor(bnd_theme.menuItemTheme.innerSelectedColor,
@@ -1687,6 +1721,7 @@ void bndMenuItem(NVGcontext *ctx,
     bndIconLabelValue(ctx,x,y,w,h,iconid,
         bndTextColor(&bnd_theme.menuItemTheme, state), BND_LEFT,
         BND_LABEL_FONT_SIZE, label, NULL);
+    BND_TRACE_END();
 }
 
 void bndNodePort(NVGcontext *ctx, float x, float y, BNDwidgetState state,
@@ -1703,6 +1738,7 @@ void bndNodePort(NVGcontext *ctx, float x, float y, BNDwidgetState state,
 
 void bndColoredNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
     NVGcolor color0, NVGcolor color1) {
+    BND_TRACE_BEGIN("bndColoredNodeWire");
     float length = bnd_fmaxf(fabsf(x1 - x0),fabsf(y1 - y0));
     float delta = length*(float)bnd_theme.nodeTheme.noodleCurving/10.0f;
 
@@ -1723,6 +1759,7 @@ void bndColoredNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
         color1));
     nvgStrokeWidth(ctx,BND_NODE_WIRE_WIDTH);
     nvgStroke(ctx);
+    BND_TRACE_END();
 }
 
 void bndNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
@@ -1734,6 +1771,7 @@ void bndNodeWire(NVGcontext *ctx, float x0, float y0, float x1, float y1,
 
 void bndNodeBackground(NVGcontext *ctx, float x, float y, float w, float h,
     BNDwidgetState state, int iconid, const char *label, NVGcolor titleColor) {
+    BND_TRACE_BEGIN("bndNodeBackground");
     bndInnerBox(ctx,x,y,w,BND_NODE_TITLE_HEIGHT+2,
         BND_NODE_RADIUS,BND_NODE_RADIUS,0,0,
         bndTransparent(bndOffsetColor(titleColor, BND_BEVEL_SHADE)),
@@ -1775,9 +1813,11 @@ void bndNodeBackground(NVGcontext *ctx, float x, float y, float w, float h,
     */
     bndDropShadow(ctx,x,y,w,h,BND_NODE_RADIUS,
         BND_SHADOW_FEATHER,BND_SHADOW_ALPHA);
+    BND_TRACE_END();
 }
 
 void bndSplitterWidgets(NVGcontext *ctx, float x, float y, float w, float h) {
+    BND_TRACE_BEGIN("bndSplitterWidgets");
     NVGcolor insetLight = bndTransparent(
         bndOffsetColor(bnd_theme.backgroundColor, BND_SPLITTER_SHADE));
     NVGcolor insetDark = bndTransparent(
@@ -1840,10 +1880,12 @@ void bndSplitterWidgets(NVGcontext *ctx, float x, float y, float w, float h) {
 
     nvgStrokeColor(ctx, inset);
     nvgStroke(ctx);
+    BND_TRACE_END();
 }
 
 void bndJoinAreaOverlay(NVGcontext *ctx, float x, float y, float w, float h,
     int vertical, int mirror) {
+    BND_TRACE_BEGIN("bndJoinAreaOverlay");
 
     if (vertical) {
         float u = w;
@@ -1896,6 +1938,7 @@ void bndJoinAreaOverlay(NVGcontext *ctx, float x, float y, float w, float h,
 
     nvgFillColor(ctx, nvgRGBAf(0,0,0,0.3));
     nvgFill(ctx);
+    BND_TRACE_END();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -14,6 +14,13 @@
 #define NANOVG_GL3_IMPLEMENTATION
 #include "nanovg_gl.h"
 
+#ifdef OUI_TRACE
+// trace the widget drawing calls along with the OUI phases
+#include "oui.h"
+#define BND_TRACE_BEGIN(name) uiTraceBegin(name)
+#define BND_TRACE_END() uiTraceEnd()
+#endif
+
 #define BLENDISH_IMPLEMENTATION
 #include "blendish.h"
 
@@ -22,6 +29,12 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#ifdef OUI_TRACE
+static void write_trace(void *user, const char *data, unsigned int size) {
+    fwrite(data, 1, size, (FILE *)user);
+}
+#endif
+
 typedef struct exContext {
     NVGcontext *vg;
     UIcontext *uictx;
@@ -131,7 +144,9 @@ void drawUI(exContext *ectx, int item, int corners);
 void drawUIItems(exContext *ectx, int item, int corners) {
     int kid = uiFirstChild(ectx->uictx, item);
     while (kid > 0) {
-        drawUI(ectx, kid, corners);
+        // layers are drawn on top of everything else
+        if (!uiIsLayer(ectx->uictx, kid))
+            drawUI(ectx, kid, corners);
         kid = uiNextSibling(ectx->uictx, kid);
     }
 }
@@ -314,6 +329,25 @@ int label(UIcontext *uictx, int iconid, const char *label) {
     return item;
 }
 
+// computes the height of a wrapped label from its layouted width
+static int labelmeasure(UIcontext *uictx, int item, int width) {
+    exContext *ec = (exContext *)uiGetContextHandle(uictx);
+    const UIButtonData *data = (const UIButtonData *)uiGetHandle(uictx, item);
+    return (int)bndLabelHeight(ec->vg, data->iconid, data->label, (float)width);
+}
+
+int wraplabel(UIcontext *uictx, int iconid, const char *label) {
+    int item = uiItem(uictx);
+    // height is measured after the width has been layouted
+    uiSetMeasure(uictx, item, labelmeasure);
+    UIButtonData *data = (UIButtonData *)uiAllocHandle(uictx, item, sizeof(UIButtonData));
+    data->head.subtype = ST_LABEL;
+    data->head.handler = NULL;
+    data->iconid = iconid;
+    data->label = label;
+    return item;
+}
+
 void demohandler(UIcontext *uictx, int item, UIevent event) {
     const UIButtonData *data = (const UIButtonData *)uiGetHandle(uictx, item);
     printf("clicked: %p %s\n", uiGetHandle(uictx, item), data->label);
@@ -837,6 +871,10 @@ void build_democontent(UIcontext *uictx, int parent) {
     column_append(uictx, col, check(uictx, "Frozen", &option1));
     column_append(uictx, col, check(uictx, "Item 7", &option2));
     column_append(uictx, col, check(uictx, "Item 8", &option3));
+
+    column_append(uictx, col, wraplabel(uictx, -1,
+        "This label wraps its text; its height is measured from the width "
+        "of the column within the same layout pass."));
 }
 
 int demorect(UIcontext *uictx, int parent, const char *label, float hue, int box, int layout, int w, int h, int m1, int m2, int m3, int m4) {
@@ -1049,6 +1087,47 @@ void build_wrapdemo(UIcontext *uictx, int parent) {
     fill_wrap_column_box(uictx, box);
 }
 
+void build_griddemo(UIcontext *uictx, int parent) {
+    const int M = 5;
+    const int T = 50;
+    int i;
+
+    int box = demorect(uictx, parent, "Box( UI_GRID | UI_JUSTIFY )\nLayout( UI_FILL )",
+            0.6f, UI_GRID | UI_JUSTIFY, UI_FILL, 0, 0, M, M, M, M);
+
+    srand(303);
+    for (i = 0; i < 24; ++i) {
+        float hue = (float)(rand()%360)/360.0f;
+        int width = 10 + (rand()%5)*10;
+        int height = 10 + (rand()%5)*10;
+
+        int u;
+        switch(rand()%4) {
+        default: break;
+        case 0: {
+            u = demorect(uictx, box, "Layout( UI_LEFT | UI_TOP )",
+                    hue, 0, UI_LEFT|UI_TOP, width, height, M, M, M, M);
+        } break;
+        case 1: {
+            u = demorect(uictx, box, "Layout( UI_CENTER )",
+                    hue, 0, UI_CENTER, width, height, M, M, M, M);
+        } break;
+        case 2: {
+            u = demorect(uictx, box, "Layout( UI_FILL )",
+                    hue, 0, UI_FILL, T, T, M, M, M, M);
+        } break;
+        case 3: {
+            u = demorect(uictx, box, "Layout( UI_RIGHT | UI_DOWN )",
+                    hue, 0, UI_RIGHT|UI_DOWN, width, height, M, M, M, M);
+        } break;
+        }
+
+        // start a new row every six cells
+        if (i && !(i%6))
+            uiSetLayout(uictx, u, uiGetLayout(uictx, u)|UI_BREAK);
+    }
+}
+
 
 int add_menu_option(UIcontext *uictx, int parent, const char *name, int *choice) {
     int opt = radio(uictx, -1, name, choice);
@@ -1087,6 +1166,7 @@ void draw(exContext *ec, float w, float h) {
     int opt_row = add_menu_option(uictx, menu, "UI_ROW", &choice);
     int opt_column = add_menu_option(uictx, menu, "UI_COLUMN", &choice);
     int opt_wrap = add_menu_option(uictx, menu, "UI_WRAP", &choice);
+    int opt_grid = add_menu_option(uictx, menu, "UI_GRID", &choice);
     if (choice < 0)
         choice = opt_blendish_demo;
 
@@ -1102,6 +1182,8 @@ void draw(exContext *ec, float w, float h) {
         UIData *data = (UIData *)uiAllocHandle(uictx, democontent, sizeof(UIData));
         data->handler = 0;
         data->subtype = ST_DEMOSTUFF;
+        // the demo is animated
+        uiRequestRedraw(uictx);
     } else if (choice == opt_oui_demo) {
         int democontent = uiItem(uictx);
         uiSetLayout(uictx, democontent, UI_TOP);
@@ -1117,11 +1199,16 @@ void draw(exContext *ec, float w, float h) {
         build_columndemo(uictx, content);
     } else if (choice == opt_wrap) {
         build_wrapdemo(uictx, content);
+    } else if (choice == opt_grid) {
+        build_griddemo(uictx, content);
     }
 
     uiEndLayout(uictx);
 
     drawUI(ec, 0, BND_CORNER_NONE);
+    for (int i = 0; i < uiGetLayerCount(uictx); ++i) {
+        drawUI(ec, uiGetLayer(uictx, i), BND_CORNER_NONE);
+    }
 
 #if 0
     for (int i = 0; i < uiGetLastItemCount(); ++i) {
@@ -1164,7 +1251,8 @@ static void mousebutton(GLFWwindow *window, int button, int action, int mods) {
 	case 2: button = 1; break;
 	}
     ec = (exContext*)glfwGetWindowUserPointer(window);
-    uiSetButton(ec->uictx, button, mods, (action == GLFW_PRESS));
+    uiSetButtonAt(ec->uictx, button, mods, (action == GLFW_PRESS),
+        (int)(glfwGetTime()*1000.0));
 }
 
 static void cursorpos(GLFWwindow *window, double x, double y) {
@@ -1199,6 +1287,7 @@ int main()
     memset(&ec, 0, sizeof(exContext));
 
     ec.uictx = uiCreateContext(4096, 1<<20);
+    uiSetContextHandle(ec.uictx, &ec);
     uiSetHandler(ec.uictx, ui_handler);
 
 	if (!glfwInit()) {
@@ -1259,6 +1348,9 @@ int main()
 
 	int peak_items = 0;
 	unsigned int peak_alloc = 0;
+#ifdef OUI_STATS
+	double max_latency = 0.0;
+#endif
 
 	while (!glfwWindowShouldClose(window))
 	{
@@ -1291,16 +1383,50 @@ int main()
         total++;
         if (total > (1*60)) {
             printf("%fms\n", (c / (double)total)*1000.0);
+#ifdef OUI_STATS
+            UIstats stats = uiGetStats(ec.uictx);
+            printf("compute %.3f/%.3fms arrange %.3f/%.3fms process %.3f/%.3fms (p50/p99)\n",
+                stats.p50[UI_PHASE_COMPUTE], stats.p99[UI_PHASE_COMPUTE],
+                stats.p50[UI_PHASE_ARRANGE], stats.p99[UI_PHASE_ARRANGE],
+                stats.p50[UI_PHASE_PROCESS], stats.p99[UI_PHASE_PROCESS]);
+            printf("max input to present latency %.3fms\n", max_latency);
+            max_latency = 0.0;
+#endif
             total = 0;
             c = 0.0;
         }
 
 		glfwSwapBuffers(window);
-		glfwPollEvents();
+#ifdef OUI_STATS
+		uiMarkPresent(ec.uictx);
+		int latencies;
+		const UIlatency *latency = uiGetLatency(ec.uictx, &latencies);
+		for (int i = 0; i < latencies; ++i) {
+			double value = latency[i].presented - latency[i].input;
+			max_latency = (value > max_latency)?value:max_latency;
+		}
+#endif
+		// sleep until the next input or timer unless the UI is still changing
+		int deadline = uiGetTimerDeadline(ec.uictx);
+		if (uiPollRedraw(ec.uictx))
+			glfwPollEvents();
+		else if (deadline >= 0) {
+			double timeout = deadline / 1000.0 - glfwGetTime();
+			glfwWaitEventsTimeout((timeout > 0.0)?timeout:0.0);
+		} else
+			glfwWaitEvents();
 	}
 	printf("Peak item count: %i (%lu bytes)\nPeak allocated handles: %u bytes\n",
 	        peak_items, peak_items * sizeof(UIitem), peak_alloc);
 
+#ifdef OUI_TRACE
+    FILE *trace = fopen("oui_trace.json", "wb");
+    if (trace) {
+        uiDumpTrace(write_trace, trace);
+        fclose(trace);
+    }
+#endif
+
     uiDestroyContext(ec.uictx);
 
 	nvgDeleteGL3(ec.vg);
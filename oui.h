@@ -251,17 +251,63 @@ void layout_window(int w, int h) {
 #define OUI_EXPORT
 #endif
 
+// define OUI_COMPACT_ITEMS along with OUI_IMPLEMENTATION to store item links
+// as 16-bit indices and item handles as 32-bit offsets into the data buffer;
+// items shrink from 32 to 24 bytes, but a context can hold at most 32767
+// items, and handles set with uiSetHandle() are stored apart from the items.
+
+// define OUI_THREADS along with OUI_IMPLEMENTATION to let uiEndLayoutBatch()
+// use threads; this requires pthreads, or the Win32 API on Windows.
+
+// define OUI_STATS along with OUI_IMPLEMENTATION to collect the performance
+// counters returned by uiGetStats(); this requires clock_gettime(), or the
+// Win32 API on Windows. In strict C modes such as -std=c99, clock_gettime()
+// is only declared with _POSIX_C_SOURCE >= 199309L; oui.h defines it, which
+// only takes effect if no system header has been included before, so define
+// it on the command line otherwise. The same applies to OUI_TRACE.
+
+// define OUI_TRACE along with OUI_IMPLEMENTATION to record the layout and
+// processing phases and all scopes passed to uiTraceBegin() into per-thread
+// ring buffers, which uiDumpTrace() writes as Chrome trace JSON; this requires
+// GCC atomic builtins, or the Win32 API on Windows.
+
+// define OUI_NO_SIMD along with OUI_IMPLEMENTATION to count the children of
+// rows and columns with scalar code only; otherwise SSE2 or NEON is used
+// where the compiler targets it.
+
 // limits
 
 enum {
-    // maximum size in bytes of a single data buffer passed to uiAllocData().
-    UI_MAX_DATASIZE = 4096,
+    // default alignment of buffers allocated with uiAllocHandle()
+    UI_HANDLE_ALIGNMENT = 8,
+    // maximum alignment of buffers passed to uiAllocHandleAligned()
+    UI_MAX_HANDLE_ALIGNMENT = 64,
     // maximum depth of nested containers
     UI_MAX_DEPTH = 64,
     // maximum number of buffered input events
     UI_MAX_INPUT_EVENTS = 64,
     // consecutive click threshold in ms
     UI_CLICK_THRESHOLD = 250,
+    // maximum number of subtrees that are layouted again within one call
+    // to uiEndLayout(); if exceeded, the entire tree is layouted again
+    UI_MAX_RELAYOUT = 64,
+    // maximum number of threads used by uiEndLayoutBatch()
+    UI_MAX_BATCH_THREADS = 64,
+    // number of frames over which uiGetStats() computes percentiles
+    UI_STATS_WINDOW = 128,
+    // number of trace events kept per thread; older events are overwritten
+    UI_TRACE_EVENTS = 4096,
+    // maximum number of cursor samples kept between calls to uiProcess()
+    UI_MAX_CURSOR_SAMPLES = 256,
+    // maximum number of events queued by one call to uiProcess()
+    UI_MAX_QUEUED_EVENTS = 256,
+    // maximum number of pending timers
+    UI_MAX_TIMERS = 64,
+    // maximum number of layers declared with uiSetLayer()
+    UI_MAX_LAYERS = 16,
+    // maximum number of drop targets collected for a drag; with more
+    // targets, the entire tree is searched as with uiFindTopItem()
+    UI_MAX_DROP_TARGETS = 1024,
 };
 
 typedef unsigned int UIuint;
@@ -297,6 +343,10 @@ typedef enum UIboxFlags {
     UI_LAYOUT = 0x000,
     // flex model
     UI_FLEX = 0x002,
+    // grid model; items are placed in cells from left to right, and an item
+    // with UI_BREAK set starts a new row. All cells of a column share the
+    // same width, all cells of a row share the same height.
+    UI_GRID = 0x001,
 
     // flex-wrap (bit 2)
 
@@ -315,6 +365,8 @@ typedef enum UIboxFlags {
     UI_END = 0x010,
     // insert spacing to stretch across whole row/column
     UI_JUSTIFY = 0x018,
+    // in grid model, these flags align the tracks in both directions;
+    // UI_JUSTIFY stretches all columns and rows evenly.
 
     // align-items
     // can be implemented by putting a flex container in a layout container,
@@ -360,6 +412,11 @@ typedef enum UIlayoutFlags {
 } UIlayoutFlags;
 
 // event flags
+// the events up to UI_CHAR are item flags within UI_ITEM_EVENT_MASK, which
+// are set with uiSetEvents() to subscribe an item. the events from UI_TIMER
+// on are never stored with an item and share their values with internal
+// item flags; they are sent regardless of the event flags of the item, and
+// can neither be passed to uiSetEvents() nor as flags to uiFindItem().
 typedef enum UIevent {
     // on button 0 down
     UI_BUTTON0_DOWN = 0x0400,
@@ -390,6 +447,17 @@ typedef enum UIevent {
     // item is focused and has received a character event
     // the respective character can be queried using uiGetKey()
     UI_CHAR = 0x40000,
+    // a timer requested with uiRequestTimer() has expired
+    UI_TIMER = 0x80000,
+    // the cursor has entered a drop target during a drag started with
+    // uiBeginDrag()
+    UI_DRAG_ENTER = 0x100000,
+    // the cursor has left a drop target, or the drag has been cancelled
+    UI_DRAG_LEAVE = 0x200000,
+    // the cursor has moved within a drop target
+    UI_DRAG_OVER = 0x400000,
+    // button 0 has been released over a drop target, ending the drag
+    UI_DROP = 0x800000,
 } UIevent;
 
 enum {
@@ -405,6 +473,10 @@ enum {
 // handler callback; event is one of UI_EVENT_*
 typedef void (*UIhandler)(UIcontext* ui_context, int item, UIevent event);
 
+// measure callback; returns the height that the item requires when it is
+// layouted with the given width, e.g. the height of a wrapped label.
+typedef int (*UImeasure)(UIcontext* ui_context, int item, int width);
+
 // for cursor positions, mainly
 typedef struct UIvec2 {
     union {
@@ -413,6 +485,24 @@ typedef struct UIvec2 {
     };
 } UIvec2;
 
+// a cursor position as recorded by uiSetCursorSample()
+typedef struct UIcursorSample {
+    UIvec2 pos;
+    // application defined timestamp, or 0 if set with uiSetCursor()
+    double time;
+} UIcursorSample;
+
+// an event queued by uiProcess() as enabled by uiSetEventQueue()
+typedef struct UIeventRecord {
+    int item;
+    UIevent event;
+    // the values uiGetKey() and uiGetModifier() return for the event
+    unsigned int key;
+    unsigned int mod;
+    // the cursor position at the time of the event
+    UIvec2 cursor;
+} UIeventRecord;
+
 // layout rectangle
 typedef struct UIrect {
     union {
@@ -421,6 +511,71 @@ typedef struct UIrect {
     };
 } UIrect;
 
+// memory allocation callbacks; alloc returns a block of at least size bytes
+// that is aligned to 8 bytes, or NULL, and free releases a block returned by
+// alloc. user is passed to both callbacks.
+typedef struct UIallocator {
+    void *(*alloc)(void *user, unsigned int size);
+    void (*free)(void *user, void *ptr);
+    void *user;
+} UIallocator;
+
+// output callback; writes size bytes from data. user is passed as given.
+typedef void (*UIwriter)(void *user, const char *data, unsigned int size);
+
+// phases of a frame timed by uiGetStats()
+typedef enum UIphase {
+    // computing sizes, including measure callbacks
+    UI_PHASE_COMPUTE = 0,
+    // arranging items
+    UI_PHASE_ARRANGE,
+    // mapping items to the previous frame in uiEndLayout()
+    UI_PHASE_MAP,
+    // finding the hot item
+    UI_PHASE_HIT_TEST,
+    // uiProcess(), including hit tests and handlers it invokes
+    UI_PHASE_PROCESS,
+
+    UI_PHASE_COUNT,
+} UIphase;
+
+// performance counters of a frame, which ends with uiProcess()
+typedef struct UIstats {
+    // number of frames counted so far
+    unsigned int frames;
+    // number of declared items
+    int items;
+    // bytes allocated with uiAllocHandle()
+    unsigned int handle_bytes;
+    // number of hit tests with uiFindItem()
+    int hit_tests;
+    // number of handler invocations
+    int handlers;
+    // time spent in each phase in milliseconds
+    float time[UI_PHASE_COUNT];
+    // median and 99th percentile of the time spent in each phase over the
+    // last UI_STATS_WINDOW frames
+    float p50[UI_PHASE_COUNT];
+    float p99[UI_PHASE_COUNT];
+} UIstats;
+
+// latency of an input consumed by uiProcess(); times are in milliseconds
+// and share an arbitrary origin
+typedef struct UIlatency {
+    // the event the input caused, or 0 for cursor motion outside of a capture
+    UIevent event;
+    // the item the event was sent to, or the hot item for cursor motion;
+    // -1 if the input reached no item
+    int item;
+    // time the input was passed to uiSetCursor(), uiSetButton(), uiSetKey(),
+    // uiSetChar() or uiSetScroll()
+    double input;
+    // time the event was sent to the item, or the input was consumed
+    double handled;
+    // time uiMarkPresent() was called, or 0 if it has not been called yet
+    double presented;
+} UIlatency;
+
 // unless declared otherwise, all operations have the complexity O(1).
 
 // Context Management
@@ -430,14 +585,40 @@ typedef struct UIrect {
 // current context. The context is managed by the client and must be released
 // using uiDestroyContext()
 // item_capacity is the maximum of number of items that can be declared.
-// buffer_capacity is the maximum total size of bytes that can be allocated
-// using uiAllocHandle(); you may pass 0 if you don't need to allocate
+// buffer_capacity is the initial total size of bytes that can be allocated
+// using uiAllocHandle(); the buffer grows as needed, unless the context has
+// been created in place. You may pass 0 if you don't need to allocate
 // handles.
 // 4096 and (1<<20) are good starting values.
 OUI_EXPORT UIcontext *uiCreateContext(
         unsigned int item_capacity,
         unsigned int buffer_capacity);
 
+// create a new UI context like uiCreateContext(), allocating its memory
+// with the given allocator; the context and all its buffers are placed in a
+// single block of uiGetContextFootprint() bytes.
+OUI_EXPORT UIcontext *uiCreateContextWithAllocator(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        const UIallocator *allocator);
+
+// returns the number of bytes a context with the given capacities occupies,
+// or 0 if the capacities are too large to be placed in a single block
+OUI_EXPORT unsigned int uiGetContextFootprint(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity);
+
+// create a new UI context like uiCreateContext() in caller-provided memory,
+// e.g. a static buffer or a shared memory segment; memory must be aligned to
+// 8 bytes and size must be at least uiGetContextFootprint() bytes, otherwise
+// NULL is returned. The context does not allocate any memory, and
+// uiDestroyContext() does not release the block.
+OUI_EXPORT UIcontext *uiCreateContextInPlace(
+        void *memory,
+        unsigned int size,
+        unsigned int item_capacity,
+        unsigned int buffer_capacity);
+
 // release the memory of an UI context created with uiCreateContext(); if the
 // context is the current context, the current context will be set to NULL
 OUI_EXPORT void uiDestroyContext(UIcontext *ctx);
@@ -453,6 +634,22 @@ OUI_EXPORT void *uiGetContextHandle(UIcontext *ui_context);
 // screen coordinates at (x,y)
 OUI_EXPORT void uiSetCursor(UIcontext *ui_context, int x, int y);
 
+// sets the current cursor position like uiSetCursor() and records it with
+// an application defined timestamp, e.g. for each event of a high-rate
+// pointing device. the positions since the last call to uiProcess() are
+// returned by uiGetCursorSamples().
+OUI_EXPORT void uiSetCursorSample(UIcontext *ui_context, int x, int y, double time);
+
+// returns the cursor positions consumed by the current or last call to
+// uiProcess(), i.e. those recorded before it, in order and stores their
+// number in count; unchanged positions are skipped. if more than
+// UI_MAX_CURSOR_SAMPLES positions are set, every other sample is dropped,
+// keeping the first and the current position.
+// This is useful in UI_BUTTON0_CAPTURE handlers to follow the full path of
+// a drag; the array is valid until the next call to uiProcess(), so that
+// consumers of queued events can read it as well.
+OUI_EXPORT const UIcursorSample *uiGetCursorSamples(UIcontext *ui_context, int *count);
+
 // returns the current cursor position in screen coordinates as set by
 // uiSetCursor()
 OUI_EXPORT UIvec2 uiGetCursor(UIcontext *ui_context);
@@ -472,8 +669,18 @@ OUI_EXPORT UIvec2 uiGetCursorStartDelta(UIcontext *ui_context);
 // source.
 // mod is an application defined set of flags for modifier keys
 // enabled is 1 for pressed, 0 for released
+// uiProcess() replays all changes since its last call in order, each at the
+// cursor position set when the change was made; to hit-test presses and
+// releases where they happened, call uiSetCursor() before uiSetButton() as
+// input arrives. up to UI_MAX_INPUT_EVENTS changes are kept per frame.
+// clicks are counted against the timestamp of the next uiProcess() call.
 OUI_EXPORT void uiSetButton(UIcontext *ui_context, unsigned int button, unsigned int mod, bool enabled);
 
+// sets a button like uiSetButton() and records the change with the time it
+// happened, in the same time base as the timestamps passed to uiProcess();
+// chained clicks are then detected even if the frame is late.
+OUI_EXPORT void uiSetButtonAt(UIcontext *ui_context, unsigned int button, unsigned int mod, bool enabled, int timestamp);
+
 // returns the current state of an application dependent input button
 // as set by uiSetButton().
 // the function returns 1 if the button has been set to pressed, 0 for released.
@@ -518,11 +725,34 @@ OUI_EXPORT void uiBeginLayout(UIcontext *ui_context);
 
 // layout all added items starting from the root item 0.
 // after calling uiEndLayout(), no further modifications to the item tree should
-// be done until the next call to uiBeginLayout().
+// be done until the next call to uiBeginLayout(), unless retained mode is
+// enabled.
 // It is safe to immediately draw the items after a call to uiEndLayout().
 // this is an O(N) operation for N = number of declared items.
 OUI_EXPORT void uiEndLayout(UIcontext *ui_context);
 
+// call uiEndLayout() on count independent contexts, distributing them among
+// up to the given number of threads, including the calling thread.
+// uiEndLayout() only accesses its own context, so the contexts are layouted
+// concurrently; measure callbacks must be safe to call from other threads.
+// Without OUI_THREADS, the contexts are layouted one after another.
+OUI_EXPORT void uiEndLayoutBatch(UIcontext **contexts, int count, int threads);
+
+// enable or disable retained mode. In retained mode, uiEndLayout() keeps a
+// copy of the declared items, and the tree can be kept across frames instead
+// of being declared again: after uiEndLayout(), items can be added, modified
+// with the uiSet*() functions, inserted or removed, and uiRelayout() updates
+// the layout of the modified parts of the tree. Queries return the previous
+// layout until uiRelayout() is called.
+// uiBeginLayout() discards the retained tree as usual.
+OUI_EXPORT void uiSetRetained(UIcontext *ui_context, bool enable);
+
+// layout the parts of a retained tree that have been modified since the last
+// call to uiEndLayout() or uiRelayout(); a modified item is layouted again
+// within its closest parent that has a fixed width and height, or within the
+// root. Item IDs and the hot, active and focus states are preserved.
+OUI_EXPORT void uiRelayout(UIcontext *ui_context);
+
 // update the current hot item; this only needs to be called if items are kept
 // for more than one frame and uiEndLayout() is not called
 OUI_EXPORT void uiUpdateHotItem(UIcontext *ui_context);
@@ -537,6 +767,34 @@ OUI_EXPORT void uiUpdateHotItem(UIcontext *ui_context);
 // this is an O(N) operation for N = number of declared items.
 OUI_EXPORT void uiProcess(UIcontext *ui_context, int timestamp);
 
+// returns 1 if the UI may have changed visibly since the last call to
+// uiPollRedraw(), otherwise 0, and resets the signal. changes are:
+// uiEndLayout() producing a different layout than the previous frame,
+// uiRelayout() updating the layout, uiProcess() or uiFocus() changing the
+// hot, active or focused item, events sent to items, and uiRequestRedraw().
+// called after uiProcess(), an event-driven application can draw the next
+// frame right away if this returns 1, and wait for input otherwise.
+OUI_EXPORT int uiPollRedraw(UIcontext *ui_context);
+
+// signal that the UI has changed visibly, e.g. to keep an animation running;
+// the next call to uiPollRedraw() returns 1.
+OUI_EXPORT void uiRequestRedraw(UIcontext *ui_context);
+
+// request a UI_TIMER event for item once delay milliseconds have passed
+// since the current or last call to uiProcess(); the event is sent by the
+// first call to uiProcess() with a timestamp at or past the deadline. the
+// item is tracked across frames with uiRecoverItem(), and the timer is
+// dropped if the item can not be recovered. if the item already has a
+// pending timer, the earlier deadline is kept, so that the request can be
+// repeated every frame. at most UI_MAX_TIMERS timers can be pending; the
+// function returns 1 if the timer is pending, or 0 if all timers are in use.
+// this is an O(log N) operation for N = number of pending timers.
+OUI_EXPORT int uiRequestTimer(UIcontext *ui_context, int item, int delay);
+
+// return the timestamp at which the next timer expires, or -1 if no timer
+// is pending; an event-driven application can wait for input until then.
+OUI_EXPORT int uiGetTimerDeadline(UIcontext *ui_context);
+
 // reset the currently stored hot/active etc. handles; this should be called when
 // a re-declaration of the UI changes the item indices, to avoid state
 // related glitches because item identities have changed.
@@ -557,22 +815,53 @@ OUI_EXPORT int uiItem(UIcontext *ui_context);
 // see example.cpp for a demonstration.
 OUI_EXPORT void uiSetFrozen(UIcontext *ui_context, int item, bool enable);
 
+// hide an item and all its child items; hidden items are skipped by
+// layouting, uiFirstChild(), uiNextSibling() and uiFindItem(), so they
+// are neither drawn nor hit, and their layout rectangles are undefined.
+// Hidden items are still matched by uiRecoverItem(), so collapsing and
+// expanding a subtree by hiding it preserves the state of its items.
+OUI_EXPORT void uiSetHidden(UIcontext *ui_context, int item, bool enable);
+
 // set the application-dependent handle of an item.
 // handle is an application defined 64-bit handle. If handle is NULL, the item
 // will not be interactive.
 OUI_EXPORT void uiSetHandle(UIcontext *ui_context, int item, void *handle);
 
 // allocate space for application-dependent context data and assign it
-// as the handle to the item.
+// as the handle to the item; the buffer is aligned to UI_HANDLE_ALIGNMENT.
 // The memory of the pointer is managed by the UI context and released
 // upon the next call to uiBeginLayout()
+// Handles are stored as offsets into a buffer that is relocated when it
+// grows, so a pointer returned by uiAllocHandle() is only valid until the
+// next allocation; use uiGetHandle() to retrieve the current pointer.
+// Returns NULL and leaves the item unchanged if the buffer can not grow,
+// i.e. if the allocator fails or the context has been created in place.
 OUI_EXPORT void *uiAllocHandle(UIcontext *ui_context, int item, unsigned int size);
 
+// same as uiAllocHandle(), with the buffer aligned to alignment, which must
+// be a power of two of at most UI_MAX_HANDLE_ALIGNMENT.
+OUI_EXPORT void *uiAllocHandleAligned(UIcontext *ui_context, int item,
+        unsigned int size, unsigned int alignment);
+
 // set the global handler callback for interactive items.
 // the handler will be called for each item whose event flags are set using
 // uiSetEvents.
 OUI_EXPORT void uiSetHandler(UIcontext *ui_context, UIhandler handler);
 
+// enable or disable queueing events instead of calling the handler; when
+// enabled, the events that would be passed to the handler are appended to
+// an array returned by uiGetEventQueue(). up to UI_MAX_QUEUED_EVENTS events
+// are queued per call to uiProcess(), including those sent since the last
+// call; further events are dropped.
+OUI_EXPORT void uiSetEventQueue(UIcontext *ui_context, bool enable);
+
+// return the events queued by the last call to uiProcess() in order and
+// store their number in count; the array is valid until the next call to
+// uiProcess(), and can be processed in any order, or on another thread.
+// Events sent between calls to uiProcess(), e.g. by uiCancelDrag(), are
+// returned along with the events of the next call.
+OUI_EXPORT const UIeventRecord *uiGetEventQueue(UIcontext *ui_context, int *count);
+
 // flags is a combination of UI_EVENT_* and designates for which events the
 // handler should be called.
 OUI_EXPORT void uiSetEvents(UIcontext *ui_context, int item, unsigned int flags);
@@ -604,10 +893,35 @@ OUI_EXPORT int uiInsertBack(UIcontext *ui_context, int item, int child);
 // same as uiInsert()
 OUI_EXPORT int uiInsertFront(UIcontext *ui_context, int item, int child);
 
+// remove an item from its container; the item keeps its children and can be
+// inserted again, e.g. to move a subtree of a retained tree to another
+// container. This is an O(N) operation for N siblings.
+OUI_EXPORT void uiRemove(UIcontext *ui_context, int item);
+
 // set the size of the item; a size of 0 indicates the dimension to be
 // dynamic; if the size is set, the item can not expand beyond that size.
 OUI_EXPORT void uiSetSize(UIcontext *ui_context, int item, int w, int h);
 
+// constrain the size of the item to a minimum and maximum size; a limit of
+// 0 leaves the dimension unconstrained. The limits apply to the computed
+// size as well as to the space assigned by filling and squeezing; space
+// that a clamped item can not take is distributed among its siblings.
+OUI_EXPORT void uiSetMinSize(UIcontext *ui_context, int item, int w, int h);
+OUI_EXPORT void uiSetMaxSize(UIcontext *ui_context, int item, int w, int h);
+
+// set a callback that computes the height of the item from its width. The
+// callback is invoked by uiEndLayout() after the width of the item has been
+// layouted and before heights are computed, so that the height of e.g.
+// wrapped text is available in the same layout pass. It is not invoked for
+// items that have a fixed height set with uiSetSize().
+// The result is cached with the item and only recomputed when the width
+// changes; calling uiSetMeasure() again discards the cached result.
+// The cache only lasts as long as the declared items: it spares the calls
+// of uiRelayout() on retained items and of a second pass for wrapping
+// columns, but uiBeginLayout() discards it, so the callback runs at least
+// once per frame when the items are declared each frame.
+OUI_EXPORT void uiSetMeasure(UIcontext *ui_context, int item, UImeasure measure);
+
 // set the anchoring behavior of the item to one or multiple UIlayoutFlags
 OUI_EXPORT void uiSetLayout(UIcontext *ui_context, int item, unsigned int flags);
 
@@ -619,6 +933,58 @@ OUI_EXPORT void uiSetBox(UIcontext *ui_context, int item, unsigned int flags);
 // from the neighboring element.
 OUI_EXPORT void uiSetMargins(UIcontext *ui_context, int item, short l, short t, short r, short b);
 
+// turn the item into a scroll view and set the offset by which its children
+// are scrolled. Children of a scroll view are layouted within the content
+// size (see uiGetContentSize()) instead of the items own size.
+// The offset is only applied when querying items with uiGetRect(),
+// uiContains() and uiFindItem(), so it can be changed after uiEndLayout()
+// without declaring and layouting the UI again; the item must have been
+// turned into a scroll view before uiEndLayout() however.
+// the offset is not clamped to the content size.
+OUI_EXPORT void uiSetScrollOffset(UIcontext *ui_context, int item, int x, int y);
+
+// move and scale the item and all its children after layouting, e.g. to
+// animate sliding panels or drag previews. The item is first scaled by
+// scale relative to its top left corner, then moved by (x,y).
+// Like the scroll offset, the transform is only applied when querying items
+// with uiGetRect(), uiContains() and uiFindItem() and does not affect
+// layouting, so it can be changed after uiEndLayout() in O(1); transforming
+// an item for the first time after uiEndLayout() costs O(N) for N = the size
+// of its subtree. Items with a scale of 0 can not be hit.
+// Pass 0, 0, 1 to reset the transform.
+OUI_EXPORT void uiSetTransform(UIcontext *ui_context, int item, float x, float y, float scale);
+
+// declare item as the root of a layer, e.g. for menus, popups and tooltips.
+// layers are ordered by z, with higher values on top; layers of equal z
+// are ordered by declaration. a layer is still layouted as a child of its
+// parent, but it is skipped when its parent is searched with uiFindItem(),
+// and uiFindTopItem() searches it before all layers below. if opaque is
+// true, the rectangle of the layer blocks all layers below, even where no
+// item of the layer matches. item 0 is the bottom layer and can not be
+// declared as a layer. at most UI_MAX_LAYERS layers can be declared per
+// frame.
+OUI_EXPORT void uiSetLayer(UIcontext *ui_context, int item, int z, bool opaque);
+
+// declare item, which must be a child of item 0, as the root of a top-level
+// window with a viewport of w by h pixels. each window is positioned at
+// (0,0) in its own coordinate space, so several OS windows can share one
+// context with item 0 as an unsized container. windows are layout
+// boundaries: in retained mode, uiRelayout() only layouts the windows that
+// have been modified, including a window whose viewport has been resized
+// with uiSetWindow() again.
+OUI_EXPORT void uiSetWindow(UIcontext *ui_context, int item, int w, int h);
+
+// set the window whose OS window receives cursor input; the cursor position
+// is in the coordinates of this window, and hit testing is restricted to it
+// and its layers. the window is tracked across frames with uiRecoverItem().
+// pass 0 to hit test the entire tree, which is the default. like
+// uiFocus(), this must be called after uiEndLayout().
+OUI_EXPORT void uiSetInputWindow(UIcontext *ui_context, int item);
+
+// return the window passed to uiSetInputWindow(), or -1 if it has not been
+// declared again
+OUI_EXPORT int uiGetInputWindow(UIcontext *ui_context);
+
 // set item as recipient of all keyboard events; if item is -1, no item will
 // be focused.
 OUI_EXPORT void uiFocus(UIcontext *ui_context, int item);
@@ -629,10 +995,12 @@ OUI_EXPORT void uiFocus(UIcontext *ui_context, int item);
 // returns the first child item of a container item. If the item is not
 // a container or does not contain any items, -1 is returned.
 // if item is 0, the first child item of the root item will be returned.
+// hidden items are skipped.
 OUI_EXPORT int uiFirstChild(UIcontext *ui_context, int item);
 
 // returns an items next sibling in the list of the parent containers children.
 // if item is 0 or the item is the last child item, -1 will be returned.
+// hidden items are skipped.
 OUI_EXPORT int uiNextSibling(UIcontext *ui_context, int item);
 
 // Querying
@@ -644,6 +1012,23 @@ OUI_EXPORT int uiGetItemCount(UIcontext *ui_context);
 // return the total bytes that have been allocated by uiAllocHandle()
 OUI_EXPORT unsigned int uiGetAllocSize(UIcontext *ui_context);
 
+// return the performance counters of the last frame completed by uiProcess();
+// all counters are zero unless OUI_STATS is defined.
+// this is an O(N^2) operation for N = UI_STATS_WINDOW, as the window of
+// each phase is insertion sorted.
+OUI_EXPORT UIstats uiGetStats(UIcontext *ui_context);
+
+// mark the frame that reflects the last call to uiProcess() as presented,
+// e.g. after swapping buffers; this completes the records returned by
+// uiGetLatency().
+OUI_EXPORT void uiMarkPresent(UIcontext *ui_context);
+
+// return the latency records of the inputs consumed by the last call to
+// uiProcess() and store their number in count; at most UI_MAX_INPUT_EVENTS
+// inputs are recorded per frame, and none unless OUI_STATS is defined.
+// the records are valid until the next call to uiProcess().
+OUI_EXPORT const UIlatency *uiGetLatency(UIcontext *ui_context, int *count);
+
 // return the current state of the item. This state is only valid after
 // a call to uiProcess().
 // The returned value is one of UI_COLD, UI_HOT, UI_ACTIVE, UI_FROZEN.
@@ -669,6 +1054,52 @@ OUI_EXPORT int uiGetFocusedItem(UIcontext *ui_context);
 OUI_EXPORT int uiFindItem(UIcontext *ui_context, int item, int x, int y,
         unsigned int flags, unsigned int mask);
 
+// same as uiFindItem(), but searches all layers declared with uiSetLayer()
+// from the top down and then the root item; the search stops at the first
+// layer that contains a matching item or that is opaque at (x,y). with an
+// opaque popup under the cursor, the cost is proportional to the size of
+// the popup rather than the entire UI.
+OUI_EXPORT int uiFindTopItem(UIcontext *ui_context, int x, int y,
+        unsigned int flags, unsigned int mask);
+
+// start a drag from item with a payload of the given type, which is a
+// combination of bits from UI_USERMASK; e.g. call this from the
+// UI_BUTTON0_DOWN or UI_BUTTON0_CAPTURE handler of item. all items whose
+// flags set with uiSetFlags() share a bit with type are drop targets.
+// the compatible targets are collected once here and again by uiEndLayout()
+// and uiRelayout(), so uiProcess() only tests those: the topmost target
+// under the cursor (see uiFindTopItem()) receives UI_DRAG_ENTER,
+// UI_DRAG_OVER and UI_DRAG_LEAVE, and UI_DROP when button 0 is released,
+// which ends the drag. like uiFocus(), this must not be called between
+// uiBeginLayout() and uiEndLayout().
+OUI_EXPORT void uiBeginDrag(UIcontext *ui_context, int item, unsigned int type);
+
+// end the current drag without dropping; the drop target under the cursor
+// receives UI_DRAG_LEAVE.
+OUI_EXPORT void uiCancelDrag(UIcontext *ui_context);
+
+// return the payload type passed to uiBeginDrag(), or 0 if no drag is in
+// progress
+OUI_EXPORT unsigned int uiGetDragType(UIcontext *ui_context);
+
+// return the item passed to uiBeginDrag(), or -1 if no drag is in progress
+// or the item has not been declared again
+OUI_EXPORT int uiGetDragSource(UIcontext *ui_context);
+
+// return the drop target under the cursor, or -1
+OUI_EXPORT int uiGetDropTarget(UIcontext *ui_context);
+
+// return the number of layers declared with uiSetLayer()
+OUI_EXPORT int uiGetLayerCount(UIcontext *ui_context);
+
+// return the root item of a layer, with index 0 being the bottom layer;
+// layers should be drawn in this order after the tree of item 0, skipping
+// them while drawing their parents (see uiIsLayer()).
+OUI_EXPORT int uiGetLayer(UIcontext *ui_context, int index);
+
+// return 1 if item has been declared as a layer with uiSetLayer()
+OUI_EXPORT int uiIsLayer(UIcontext *ui_context, int item);
+
 // return the handler callback as passed to uiSetHandler()
 OUI_EXPORT UIhandler uiGetHandler(UIcontext *ui_context);
 // return the event flags for an item as passed to uiSetEvents()
@@ -681,15 +1112,34 @@ OUI_EXPORT unsigned int uiGetKey(UIcontext *ui_context);
 // when handling a keyboard or mouse event: the active modifier keys
 OUI_EXPORT unsigned int uiGetModifier(UIcontext *ui_context);
 
-// returns the items layout rectangle in absolute coordinates. If
-// uiGetRect() is called before uiEndLayout(), the values of the returned
-// rectangle are undefined.
+// returns the items layout rectangle in absolute coordinates, with the
+// offsets of all containing scroll views and the transforms of the item and
+// its parents applied. If uiGetRect() is called before uiEndLayout(), the
+// values of the returned rectangle are undefined.
+// this is an O(1) operation for items outside of scroll views and
+// transformed items, and O(D) otherwise for D = the number of parents up to
+// the topmost scroll view or transformed item.
 OUI_EXPORT UIrect uiGetRect(UIcontext *ui_context, int item);
 
 // returns 1 if an items absolute rectangle contains a given coordinate
 // otherwise 0
 OUI_EXPORT int uiContains(UIcontext *ui_context, int item, int x, int y);
 
+// returns the accumulated scale of the item and all its parents as set by
+// uiSetTransform(); the cost is the same as for uiGetRect().
+OUI_EXPORT float uiGetScale(UIcontext *ui_context, int item);
+
+// returns the scroll offset of a scroll view as set by uiSetScrollOffset()
+OUI_EXPORT UIvec2 uiGetScrollOffset(UIcontext *ui_context, int item);
+
+// returns the size of the content of a scroll view after layouting, which
+// is the larger of the items own size and the space its children require.
+// for items that are not scroll views, the items size is returned.
+// a scroll bar for the vertical axis can be drawn with
+// bndScrollBar(..., offset.y / (float)(content.h - rect.h),
+//     rect.h / (float)content.h)
+OUI_EXPORT UIvec2 uiGetContentSize(UIcontext *ui_context, int item);
+
 // return the width of the item as set by uiSetSize()
 OUI_EXPORT int uiGetWidth(UIcontext *ui_context, int item);
 // return the height of the item as set by uiSetSize()
@@ -727,6 +1177,43 @@ OUI_EXPORT void uiRemapItem(UIcontext *ui_context, int olditem, int newitem);
 // returns the number if items that have been allocated in the last frame
 OUI_EXPORT int uiGetLastItemCount(UIcontext *ui_context);
 
+// Tracing
+// -------
+
+// all tracing functions do nothing unless OUI_TRACE is defined. scopes are
+// recorded per thread and do not depend on a context.
+
+// begin a trace scope on the calling thread; name must remain valid until
+// the trace has been dumped, e.g. a string literal. scopes must be closed
+// with uiTraceEnd() in reverse order and may be nested UI_MAX_DEPTH deep.
+OUI_EXPORT void uiTraceBegin(const char *name);
+
+// close the innermost trace scope of the calling thread and record it
+OUI_EXPORT void uiTraceEnd(void);
+
+// write the recorded scopes of all threads as Chrome trace JSON, which can
+// be loaded in chrome://tracing or Perfetto; the output is passed to write
+// in pieces. scopes recorded while dumping may be missing.
+// this is an O(N) operation for N = UI_TRACE_EVENTS * number of threads.
+OUI_EXPORT void uiDumpTrace(UIwriter write, void *user);
+
+// enable or disable measuring the time spent in computing sizes and
+// arranging each subtree; the times of the next uiEndLayout(), and of
+// following calls to uiRelayout(), are reported by uiDumpLayout().
+// this requires OUI_STATS and slows down the layout noticeably.
+OUI_EXPORT void uiSetInspect(UIcontext *ui_context, bool enable);
+
+// write the layouted subtree of item as JSON array of objects, one for each
+// visible item, with children preceding their parents:
+// {"item":index,"parent":index,"box":flags,"layout":flags,"rect":[x,y,w,h],
+//  "count":items in subtree,"compute":ms,"arrange":ms}
+// times are zero unless measured with uiSetInspect(). rect is the layouted
+// rectangle in absolute coordinates, without scroll offsets and transforms.
+// the output is passed to write in pieces.
+// this is an O(N) operation for N = number of items in the subtree.
+OUI_EXPORT void uiDumpLayout(UIcontext *ui_context, int item,
+        UIwriter write, void *user);
+
 #ifdef __cplusplus
 };
 #endif
@@ -735,7 +1222,52 @@ OUI_EXPORT int uiGetLastItemCount(UIcontext *ui_context);
 
 #ifdef OUI_IMPLEMENTATION
 
+// clock_gettime() is not declared in strict C modes otherwise
+#if (defined(OUI_STATS) || defined(OUI_TRACE)) && !defined(_WIN32) \
+        && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
 #include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef OUI_THREADS
+    #ifdef _WIN32
+    #include <windows.h>
+    #else
+    #include <pthread.h>
+    #endif
+#endif
+
+#if defined(OUI_STATS) || defined(OUI_TRACE)
+    #ifdef _WIN32
+    #include <windows.h>
+    #else
+    #include <time.h>
+    #endif
+#endif
+
+#ifndef OUI_NO_SIMD
+    #if defined(__SSE2__) || defined(_M_X64) \
+            || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define UI_SIMD_SSE2
+    #include <emmintrin.h>
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define UI_SIMD_NEON
+    #include <arm_neon.h>
+    #endif
+#endif
+
+#ifdef OUI_TRACE
+    #ifdef _MSC_VER
+    #define UI_THREAD_LOCAL __declspec(thread)
+    #else
+    #define UI_THREAD_LOCAL __thread
+    #endif
+#endif
 
 #ifdef _MSC_VER
     #pragma warning (disable: 4996) // Switch off security warnings
@@ -749,10 +1281,11 @@ OUI_EXPORT int uiGetLastItemCount(UIcontext *ui_context);
     #define UI_INLINE
     #endif
 #else
-    #ifdef __clang__
-    #define UI_INLINE static inline
-    #else
+    #if defined(__cplusplus) && !defined(__clang__)
     #define UI_INLINE inline
+    #else
+    // C99 emits no external definition for plain inline functions
+    #define UI_INLINE static inline
     #endif
 #endif
 
@@ -788,10 +1321,10 @@ enum {
     UI_ITEM_EVENT_MASK  = 0x07FC00,
     // item is frozen (bit 19)
     UI_ITEM_FROZEN      = 0x080000,
-    // item handle is pointer to data (bit 20)
+    // item handle is an offset into the data buffer (bit 20)
     UI_ITEM_DATA	    = 0x100000,
-    // item has been inserted (bit 21)
-    UI_ITEM_INSERTED	= 0x200000,
+    // item and its children are hidden (bit 21)
+    UI_ITEM_HIDDEN      = 0x200000,
     // horizontal size has been explicitly set (bit 22)
     UI_ITEM_HFIXED      = 0x400000,
     // vertical size has been explicitly set (bit 23)
@@ -806,18 +1339,33 @@ enum {
         | UI_USERMASK,
 };
 
+#ifdef OUI_COMPACT_ITEMS
+typedef short UIindex;
+#else
+typedef int UIindex;
+#endif
+
 typedef struct UIitem {
-    // data handle
-    void *handle;
+#ifdef OUI_COMPACT_ITEMS
+    // offset of the data handle in the data buffer
+    unsigned int offset;
+#else
+    union {
+        // data handle
+        void *handle;
+        // offset of the data handle in the data buffer if UI_ITEM_DATA is set
+        unsigned int offset;
+    };
+#endif
 
     // about 27 bits worth of flags
     unsigned int flags;
 
     // index of first kid
     // if old item: index of equivalent new item
-    int firstkid;
+    UIindex firstkid;
     // index of next sibling with same parent
-    int nextitem;
+    UIindex nextitem;
 
     // margin offsets, interpretation depends on flags
     // after layouting, the first two components are absolute coordinates
@@ -826,6 +1374,61 @@ typedef struct UIitem {
     short size[2];
 } UIitem;
 
+enum {
+    // extended attribute flags
+
+    // item is a scroll view
+    UI_EXT_SCROLL = 0x0001,
+    // item has a transform
+    UI_EXT_TRANSFORM = 0x0002,
+    // item has a measure callback
+    UI_EXT_MEASURE = 0x0004,
+    // measured height is cached
+    UI_EXT_MEASURED = 0x0008,
+    // item has size limits
+    UI_EXT_LIMITS = 0x0010,
+    // item has been clamped to its limits while arranging
+    UI_EXT_CLAMPED = 0x0020,
+    // item has a handle set with uiSetHandle()
+    UI_EXT_HANDLE = 0x0040,
+    // item is the root of a layer
+    UI_EXT_LAYER = 0x0080,
+    // the layer blocks the layers below
+    UI_EXT_OPAQUE = 0x0100,
+    // item is the root of a window
+    UI_EXT_WINDOW = 0x0200,
+};
+
+// rarely used item attributes, allocated on demand and stored apart from
+// UIitem to keep the item buffer compact
+typedef struct UIitemExt {
+    // item the attributes belong to
+    int item;
+    // combination of UI_EXT_*
+    unsigned int flags;
+    // offset by which the children of a scroll view are moved
+    int scroll[2];
+    // size of the children of a scroll view
+    short content[2];
+    // translation and scale applied after layouting
+    float offset[2];
+    float scale;
+    // height for width callback, and the result cached until uiClear()
+    UImeasure measure;
+    short measured_width;
+    short measured_height;
+    // size limits, and the next item with limits while arranging
+    short minsize[2];
+    short maxsize[2];
+    int next_clamped;
+    // z order of a layer
+    int layer;
+#ifdef OUI_COMPACT_ITEMS
+    // handles that are not in the data buffer
+    void *handle;
+#endif
+} UIitemExt;
+
 typedef enum UIstate {
     UI_STATE_IDLE = 0,
     UI_STATE_CAPTURE,
@@ -846,8 +1449,33 @@ typedef struct UIinputEvent {
     unsigned int key;
     unsigned int mod;
     UIevent event;
+    // arrival time for latency records, or 0
+    double time;
 } UIinputEvent;
 
+// a pending timer
+typedef struct UItimer {
+    int deadline;
+    int item;
+    // true if requested between uiBeginLayout() and uiEndLayout(), so that
+    // item already belongs to the new frame
+    bool fresh;
+} UItimer;
+
+// a change of button states, replayed by uiProcess() in order
+typedef struct UIbuttonStep {
+    // cursor position at the time of the change
+    UIvec2 cursor;
+    // button states after the change
+    unsigned long long buttons;
+    unsigned int mod;
+    // application timestamp of the change, if timed
+    int timestamp;
+    bool timed;
+    // arrival time for latency records, or 0
+    double time;
+} UIbuttonStep;
+
 struct UIcontext {
     unsigned int item_capacity;
     unsigned int buffer_capacity;
@@ -873,6 +1501,8 @@ struct UIcontext {
 
     int active_item;
     int focus_item;
+    // window passed to uiSetInputWindow(), or 0
+    int input_window;
     int last_hot_item;
     int last_click_item;
     int hot_item;
@@ -882,20 +1512,101 @@ struct UIcontext {
     unsigned int active_key;
     unsigned int active_modifier;
     unsigned int active_button_modifier;
+    // timestamp of the current or last call to uiProcess()
     int last_timestamp;
     int last_click_timestamp;
     int clicks;
+    // arrival times of the first cursor, button and scroll input since the
+    // last call to uiProcess(), or 0
+    double cursor_time;
+    double button_time;
+    double scroll_time;
 
     int count;
     int last_count;
     int eventcount;
+    int stepcount;
+    int samplecount;
+    int last_samplecount;
+    // true if events are queued instead of passed to the handler
+    bool queue_events;
+    // true if the UI may have changed visibly since uiPollRedraw()
+    bool redraw;
+    // pending timers as min-heap by deadline
+    int timercount;
+    UItimer timers[UI_MAX_TIMERS];
+    // layer roots, sorted by z order from bottom to top
+    int layercount;
+    int layers[UI_MAX_LAYERS];
+    // payload type of the current drag, or 0
+    unsigned int drag_type;
+    int drag_source;
+    int drag_target;
+    // cursor position of the last drag event
+    UIvec2 drag_cursor;
+    // compatible drop targets in hit testing order, and the index of the
+    // first target within each layer
+    int drag_targetcount;
+    int drag_layerstart[UI_MAX_LAYERS];
+    int drag_targets[UI_MAX_DROP_TARGETS];
+    int queuecount;
+    // number of queued events returned by uiGetEventQueue(); later events
+    // are kept for the next call to uiProcess()
+    int queuebatch;
     unsigned int datasize;
+    // separately allocated data buffer after growing, or NULL
+    void *data_block;
 
     UIitem *items;
     unsigned char *data;
     UIitem *last_items;
     int *item_map;
+    // scratch space for grid track sizes and offsets
+    short *tracks;
+    // allocator of the memory block holding the context and its buffers
+    UIallocator allocator;
+#ifdef OUI_STATS
+    // counters of the current and the last frame
+    UIstats stats;
+    UIstats last_stats;
+    // phase times of the last UI_STATS_WINDOW frames
+    float stats_window[UI_PHASE_COUNT][UI_STATS_WINDOW];
+    // true if the compute and arrange times of each subtree are measured
+    bool inspect;
+    // compute and arrange times of each subtree
+    float *costs;
+    // inputs consumed by the last call to uiProcess()
+    int latencycount;
+    UIlatency latency[UI_MAX_INPUT_EVENTS];
+#endif
+    // copy of the declared items, used to layout subtrees again
+    UIitem *source_items;
+    // true if the declared items contain wrapping columns
+    bool has_column_wraps;
+    // true while subtrees are layouted again
+    bool relayouting;
+    // items whose layout has changed after their parents were arranged
+    int relayoutcount;
+    int relayout[UI_MAX_RELAYOUT];
+    // true if the declared items are kept after uiEndLayout()
+    bool retained;
+    // retained items that have been modified since they were layouted
+    int dirtycount;
+    int dirty[UI_MAX_RELAYOUT];
+    // index of the parent of each item, or -1
+    int *parents;
+    // index of the extended attributes of each item, or -1
+    int *item_ext;
+    // nonzero for scroll views, transformed items and their subtrees; the
+    // rects of all other items are their layouted rects
+    unsigned char *moved;
+    UIitemExt *exts;
+    int extcount;
     UIinputEvent events[UI_MAX_INPUT_EVENTS];
+    UIbuttonStep steps[UI_MAX_INPUT_EVENTS];
+    UIcursorSample samples[UI_MAX_CURSOR_SAMPLES];
+    UIcursorSample last_samples[UI_MAX_CURSOR_SAMPLES];
+    UIeventRecord queue[UI_MAX_QUEUED_EVENTS];
 };
 
 UI_INLINE int ui_max(int a, int b) {
@@ -914,11 +1625,376 @@ UI_INLINE float ui_minf(float a, float b) {
     return (a<b)?a:b;
 }
 
+UI_INLINE int ui_round(float a) {
+    return (int)((a<0.0f)?(a-0.5f):(a+0.5f));
+}
+
+// returns a timestamp in milliseconds for the performance counters and traces
+UI_INLINE double uiClock(void) {
+#if (defined(OUI_STATS) || defined(OUI_TRACE)) && defined(_WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#elif defined(OUI_STATS) || defined(OUI_TRACE)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec * 1e-6;
+#else
+    return 0.0;
+#endif
+}
+
+#ifdef OUI_TRACE
+
+// a closed trace scope; times are in microseconds
+typedef struct UItraceEvent {
+    const char *name;
+    double start;
+    float duration;
+    // item passed to the handler, or -1
+    int item;
+} UItraceEvent;
+
+// trace events of one thread; only the owning thread writes to the ring,
+// other threads read events below head.
+typedef struct UItraceRing {
+    struct UItraceRing *next;
+    int thread;
+    // number of events recorded so far
+    volatile unsigned int head;
+    // head + 1 while an event is written, otherwise head
+    volatile unsigned int claimed;
+    // nonzero while a thread records into the ring
+    volatile long used;
+    // open scopes
+    int depth;
+    UItraceEvent scopes[UI_MAX_DEPTH];
+    UItraceEvent events[UI_TRACE_EVENTS];
+} UItraceRing;
+
+// rings of all threads that have traced; rings are never freed, but the
+// rings of threads that have exited are reused, so there are at most as
+// many rings as concurrently tracing threads
+static UItraceRing *volatile ui_trace_rings = NULL;
+static volatile long ui_trace_threads = 0;
+static UI_THREAD_LOCAL UItraceRing *ui_trace_ring = NULL;
+
+static void uiTraceBarrier(void) {
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
+// returns the ring of the calling thread, registering it on first use
+static UItraceRing *uiGetTraceRing(void) {
+    UItraceRing *ring = ui_trace_ring;
+    if (ring)
+        return ring;
+    for (ring = ui_trace_rings; ring; ring = ring->next) {
+#ifdef _WIN32
+        if (!ring->used && !InterlockedCompareExchange(&ring->used, 1, 0)) {
+#else
+        if (!ring->used && __sync_bool_compare_and_swap(&ring->used, 0, 1)) {
+#endif
+            ring->depth = 0;
+            ui_trace_ring = ring;
+            return ring;
+        }
+    }
+    ring = (UItraceRing *)calloc(1, sizeof(UItraceRing));
+    if (!ring)
+        return NULL;
+    ring->used = 1;
+#ifdef _WIN32
+    ring->thread = (int)InterlockedIncrement(&ui_trace_threads);
+    do {
+        ring->next = ui_trace_rings;
+    } while (InterlockedCompareExchangePointer((PVOID volatile *)&ui_trace_rings,
+        ring, ring->next) != ring->next);
+#else
+    ring->thread = (int)__sync_add_and_fetch(&ui_trace_threads, 1);
+    do {
+        ring->next = ui_trace_rings;
+    } while (!__sync_bool_compare_and_swap(&ui_trace_rings, ring->next, ring));
+#endif
+    ui_trace_ring = ring;
+    return ring;
+}
+
+#ifdef OUI_THREADS
+// hand the ring of the calling thread, which is about to exit, over to
+// the next thread that starts tracing; its events are kept
+static void uiReleaseTraceRing(void) {
+    UItraceRing *ring = ui_trace_ring;
+    if (!ring)
+        return;
+    ui_trace_ring = NULL;
+    uiTraceBarrier();
+    ring->used = 0;
+}
+#endif
+
+static void uiTraceBeginItem(const char *name, int item) {
+    UItraceRing *ring = uiGetTraceRing();
+    if (!ring)
+        return;
+    // scopes nested deeper than UI_MAX_DEPTH are not recorded
+    if (ring->depth < UI_MAX_DEPTH) {
+        UItraceEvent *scope = &ring->scopes[ring->depth];
+        scope->name = name;
+        scope->item = item;
+        scope->start = uiClock() * 1000.0;
+    }
+    ring->depth++;
+}
+
+void uiTraceBegin(const char *name) {
+    uiTraceBeginItem(name, -1);
+}
+
+void uiTraceEnd(void) {
+    UItraceRing *ring = ui_trace_ring;
+    if (!ring)
+        return;
+    assert(ring->depth > 0); // must run uiTraceBegin() first
+    if (ring->depth <= 0)
+        return;
+    ring->depth--;
+    if (ring->depth >= UI_MAX_DEPTH)
+        return;
+    ring->claimed = ring->head + 1;
+    uiTraceBarrier();
+    UItraceEvent *event = &ring->events[ring->head % UI_TRACE_EVENTS];
+    *event = ring->scopes[ring->depth];
+    event->duration = (float)(uiClock() * 1000.0 - event->start);
+    // publish the event before advancing head
+    uiTraceBarrier();
+    ring->head++;
+}
+
+// format an event as JSON object into buffer, returns the length
+static int uiFormatTraceEvent(char *buffer, const UItraceEvent *event,
+        int thread) {
+    const char *name = event->name;
+    int len = sprintf(buffer, "{\"name\":\"");
+    // names are escaped and truncated to 128 characters
+    while (*name && (len < 128 + 9)) {
+        char c = *name++;
+        if ((c == '"') || (c == '\\'))
+            buffer[len++] = '\\';
+        buffer[len++] = ((unsigned char)c < 0x20)?' ':c;
+    }
+    len += sprintf(buffer + len,
+        "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+        event->start, (double)event->duration, thread);
+    if (event->item >= 0)
+        len += sprintf(buffer + len, ",\"args\":{\"item\":%d}", event->item);
+    buffer[len++] = '}';
+    return len;
+}
+
+void uiDumpTrace(UIwriter write, void *user) {
+    assert(write);
+    char buffer[512];
+    bool first = true;
+    UItraceRing *ring;
+    uiTraceBarrier();
+    write(user, "{\"traceEvents\":[", 16);
+    for (ring = ui_trace_rings; ring; ring = ring->next) {
+        unsigned int head = ring->head;
+        unsigned int i = (head > UI_TRACE_EVENTS)?(head - UI_TRACE_EVENTS):0;
+        uiTraceBarrier();
+        for (; i != head; ++i) {
+            UItraceEvent event = ring->events[i % UI_TRACE_EVENTS];
+            // skip events the owning thread may have overwritten meanwhile
+            uiTraceBarrier();
+            if ((ring->claimed - i) > UI_TRACE_EVENTS)
+                continue;
+            int len = 0;
+            if (!first)
+                buffer[len++] = ',';
+            len += uiFormatTraceEvent(buffer + len, &event, ring->thread);
+            write(user, buffer, (unsigned int)len);
+            first = false;
+        }
+    }
+    write(user, "]}\n", 3);
+}
+
+#else
+
+void uiTraceBegin(const char *name) {
+    (void)name;
+}
+
+void uiTraceEnd(void) {
+}
+
+void uiDumpTrace(UIwriter write, void *user) {
+    (void)write; (void)user;
+}
+
+#endif // OUI_TRACE
+
+#ifdef OUI_TRACE
+static const char *ui_phase_names[UI_PHASE_COUNT] = {
+    "uiComputeSize", "uiArrange", "uiMapItems", "uiUpdateHotItem", "uiProcess"
+};
+#endif
+
+// begin a phase of the current frame; returns the start timestamp
+static double uiBeginPhase(UIphase phase) {
+#ifdef OUI_TRACE
+    uiTraceBeginItem(ui_phase_names[phase], -1);
+#else
+    (void)phase;
+#endif
+#ifdef OUI_STATS
+    return uiClock();
+#else
+    return 0.0;
+#endif
+}
+
+// add the time passed since start to a phase of the current frame
+static void uiEndPhase(UIcontext *ui_context, UIphase phase, double start) {
+#ifdef OUI_STATS
+    ui_context->stats.time[phase] += (float)(uiClock() - start);
+#else
+    (void)ui_context; (void)phase; (void)start;
+#endif
+#ifdef OUI_TRACE
+    uiTraceEnd();
+#endif
+}
+
+// returns the start timestamp for measuring the cost of a subtree
+UI_INLINE double uiBeginCost(UIcontext *ui_context) {
+#ifdef OUI_STATS
+    return ui_context->inspect?uiClock():0.0;
+#else
+    (void)ui_context;
+    return 0.0;
+#endif
+}
+
+// add the time passed since start to the compute or arrange cost of item
+UI_INLINE void uiEndCost(UIcontext *ui_context, int item, UIphase phase,
+        double start) {
+#ifdef OUI_STATS
+    if (ui_context->inspect)
+        ui_context->costs[item * 2 + phase] += (float)(uiClock() - start);
+#else
+    (void)ui_context; (void)item; (void)phase; (void)start;
+#endif
+}
+
+// returns the arrival time of an input for latency records, or 0
+UI_INLINE double uiInputTime(void) {
+#ifdef OUI_STATS
+    return uiClock();
+#else
+    return 0.0;
+#endif
+}
+
+// record that an input that arrived at time input caused event for item
+UI_INLINE void uiRecordLatency(UIcontext *ui_context, UIevent event, int item,
+        double input) {
+#ifdef OUI_STATS
+    if (!input || (ui_context->latencycount == UI_MAX_INPUT_EVENTS))
+        return;
+    UIlatency *record = &ui_context->latency[ui_context->latencycount++];
+    record->event = event;
+    record->item = item;
+    record->input = input;
+    record->handled = uiClock();
+    record->presented = 0.0;
+#else
+    (void)ui_context; (void)event; (void)item; (void)input;
+#endif
+}
+
+// complete the counters of the current frame
+static void uiCommitStats(UIcontext *ui_context) {
+#ifdef OUI_STATS
+    UIstats *stats = &ui_context->stats;
+    int i;
+    int sample = ui_context->last_stats.frames % UI_STATS_WINDOW;
+    stats->frames = ui_context->last_stats.frames + 1;
+    stats->items = ui_context->count;
+    stats->handle_bytes = ui_context->datasize;
+    for (i = 0; i < UI_PHASE_COUNT; ++i) {
+        ui_context->stats_window[i][sample] = stats->time[i];
+    }
+    ui_context->last_stats = *stats;
+    memset(stats, 0, sizeof(UIstats));
+#else
+    (void)ui_context;
+#endif
+}
+
+UIstats uiGetStats(UIcontext *ui_context) {
+    assert(ui_context);
+    UIstats stats;
+#ifdef OUI_STATS
+    float samples[UI_STATS_WINDOW];
+    int i, j, k;
+    stats = ui_context->last_stats;
+    int count = ui_min((int)stats.frames, UI_STATS_WINDOW);
+    for (i = 0; count && (i < UI_PHASE_COUNT); ++i) {
+        // insertion sort the window
+        for (j = 0; j < count; ++j) {
+            float value = ui_context->stats_window[i][j];
+            for (k = j; (k > 0) && (samples[k-1] > value); --k) {
+                samples[k] = samples[k-1];
+            }
+            samples[k] = value;
+        }
+        stats.p50[i] = samples[(count - 1) / 2];
+        stats.p99[i] = samples[(count - 1) * 99 / 100];
+    }
+#else
+    memset(&stats, 0, sizeof(UIstats));
+#endif
+    return stats;
+}
+
+void uiMarkPresent(UIcontext *ui_context) {
+    assert(ui_context);
+#ifdef OUI_STATS
+    int i;
+    double now = uiClock();
+    for (i = 0; i < ui_context->latencycount; ++i) {
+        if (!ui_context->latency[i].presented)
+            ui_context->latency[i].presented = now;
+    }
+#endif
+}
+
+const UIlatency *uiGetLatency(UIcontext *ui_context, int *count) {
+    assert(ui_context && count);
+#ifdef OUI_STATS
+    *count = ui_context->latencycount;
+    return ui_context->latency;
+#else
+    *count = 0;
+    return NULL;
+#endif
+}
+
 void uiClear(UIcontext *ui_context) {
     int i;
     ui_context->last_count = ui_context->count;
     ui_context->count = 0;
     ui_context->datasize = 0;
+    ui_context->extcount = 0;
+    ui_context->layercount = 0;
+    ui_context->has_column_wraps = false;
+    ui_context->dirtycount = 0;
     ui_context->hot_item = -1;
     // swap buffers
     UIitem *items = ui_context->items;
@@ -929,40 +2005,144 @@ void uiClear(UIcontext *ui_context) {
     }
 }
 
-static UIcontext *uiInitializeContext(
-        UIcontext *ctx,
+// buffers within the memory block of a context are aligned to this size
+#define UI_BUFFER_ALIGNMENT 16
+// largest memory block of a context, whose size is passed as unsigned int
+#define UI_MAX_FOOTPRINT ((size_t)UINT_MAX & ~(size_t)(UI_BUFFER_ALIGNMENT - 1))
+
+// returns the address of a buffer of count elements of size bytes at offset
+// within memory, and advances offset past the buffer; if the buffer does
+// not fit into UI_MAX_FOOTPRINT, offset is moved past it
+UI_INLINE void *uiPlaceBuffer(unsigned char *memory, size_t *offset,
+        size_t count, size_t size) {
+    void *buffer = memory?(memory + *offset):NULL;
+    if ((*offset > UI_MAX_FOOTPRINT)
+            || (count > (UI_MAX_FOOTPRINT - *offset) / size)) {
+        *offset = UI_MAX_FOOTPRINT + 1;
+        return buffer;
+    }
+    *offset += (count * size + UI_BUFFER_ALIGNMENT - 1) & ~(size_t)(UI_BUFFER_ALIGNMENT - 1);
+    return buffer;
+}
+
+UI_INLINE unsigned char *uiAlignPointer(unsigned char *ptr) {
+    return ptr + ((UI_MAX_HANDLE_ALIGNMENT - ((size_t)ptr & (UI_MAX_HANDLE_ALIGNMENT - 1)))
+        & (UI_MAX_HANDLE_ALIGNMENT - 1));
+}
+
+// place the buffers of a context in the memory block following the
+// context; returns the size of the block, or a size beyond
+// UI_MAX_FOOTPRINT if the capacities are too large
+static size_t uiPlaceBuffers(UIcontext *ctx, unsigned char *memory) {
+    size_t capacity = ctx->item_capacity;
+    size_t offset = 0;
+    uiPlaceBuffer(memory, &offset, 1, sizeof(UIcontext));
+    ctx->items = (UIitem *)uiPlaceBuffer(memory, &offset, capacity, sizeof(UIitem));
+    ctx->last_items = (UIitem *)uiPlaceBuffer(memory, &offset, capacity, sizeof(UIitem));
+    ctx->source_items = (UIitem *)uiPlaceBuffer(memory, &offset, capacity, sizeof(UIitem));
+    ctx->exts = (UIitemExt *)uiPlaceBuffer(memory, &offset, capacity, sizeof(UIitemExt));
+    ctx->item_map = (int *)uiPlaceBuffer(memory, &offset, capacity, sizeof(int));
+    ctx->parents = (int *)uiPlaceBuffer(memory, &offset, capacity, sizeof(int));
+    ctx->item_ext = (int *)uiPlaceBuffer(memory, &offset, capacity, sizeof(int));
+    ctx->moved = (unsigned char *)uiPlaceBuffer(memory, &offset, capacity, 1);
+    ctx->tracks = (short *)uiPlaceBuffer(memory, &offset, capacity, sizeof(short) * 2);
+#ifdef OUI_STATS
+    ctx->costs = (float *)uiPlaceBuffer(memory, &offset, capacity, sizeof(float) * 2);
+#endif
+    // the data buffer is aligned to the largest handle alignment, so that
+    // handle alignment is preserved when the buffer is relocated
+    ctx->data = NULL;
+    if (ctx->buffer_capacity) {
+        unsigned char *data = (unsigned char *)uiPlaceBuffer(memory, &offset,
+            (size_t)ctx->buffer_capacity + UI_MAX_HANDLE_ALIGNMENT - 1, 1);
+        if (memory)
+            ctx->data = uiAlignPointer(data);
+    }
+    return offset;
+}
+
+unsigned int uiGetContextFootprint(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity) {
+    UIcontext ctx;
+    ctx.item_capacity = item_capacity;
+    ctx.buffer_capacity = buffer_capacity;
+    size_t size = uiPlaceBuffers(&ctx, NULL);
+    return (size > UI_MAX_FOOTPRINT)?0:(unsigned int)size;
+}
+
+UIcontext *uiCreateContextInPlace(
+        void *memory,
+        unsigned int size,
         unsigned int item_capacity,
         unsigned int buffer_capacity) {
+    if (!memory || ((size_t)memory & 7) || !item_capacity)
+        return NULL;
+#ifdef OUI_COMPACT_ITEMS
+    // item indices must fit UIindex
+    if (item_capacity > 0x7FFF)
+        return NULL;
+#endif
+    unsigned int footprint = uiGetContextFootprint(item_capacity, buffer_capacity);
+    if (!footprint || (size < footprint))
+        return NULL;
+    UIcontext *ctx = (UIcontext *)memory;
     memset(ctx, 0, sizeof(UIcontext));
     ctx->item_capacity = item_capacity;
     ctx->buffer_capacity = buffer_capacity;
     ctx->stage = UI_STAGE_PROCESS;
-    ctx->items = (UIitem *)malloc(sizeof(UIitem) * item_capacity);
-    ctx->last_items = (UIitem *)malloc(sizeof(UIitem) * item_capacity);
-    ctx->item_map = (int *)malloc(sizeof(int) * item_capacity);
-    if (buffer_capacity) {
-        ctx->data = (unsigned char *)malloc(buffer_capacity);
+    uiPlaceBuffers(ctx, (unsigned char *)memory);
+    uiClear(ctx);
+    uiClearState(ctx);
+    return ctx;
+}
+
+static void *uiDefaultAlloc(void *user, unsigned int size) {
+    (void)user;
+    return malloc(size);
+}
+
+static void uiDefaultFree(void *user, void *ptr) {
+    (void)user;
+    free(ptr);
+}
+
+UIcontext *uiCreateContextWithAllocator(
+        unsigned int item_capacity,
+        unsigned int buffer_capacity,
+        const UIallocator *allocator) {
+    assert(allocator && allocator->alloc);
+    unsigned int size = uiGetContextFootprint(item_capacity, buffer_capacity);
+    if (!size)
+        return NULL;
+    void *memory = allocator->alloc(allocator->user, size);
+    if (!memory)
+        return NULL;
+    UIcontext *ctx = uiCreateContextInPlace(memory, size,
+        item_capacity, buffer_capacity);
+    if (!ctx) {
+        if (allocator->free)
+            allocator->free(allocator->user, memory);
+        return NULL;
     }
+    ctx->allocator = *allocator;
     return ctx;
 }
 
 UIcontext *uiCreateContext(
         unsigned int item_capacity,
         unsigned int buffer_capacity) {
-    assert(item_capacity);
-    UIcontext *ctx = (UIcontext *)malloc(sizeof(UIcontext));
-    uiInitializeContext(ctx, item_capacity, buffer_capacity);
-    uiClear(ctx);
-    uiClearState(ctx);
-    return ctx;
+    UIallocator allocator = { uiDefaultAlloc, uiDefaultFree, NULL };
+    return uiCreateContextWithAllocator(item_capacity, buffer_capacity, &allocator);
 }
 
 void uiDestroyContext(UIcontext *ctx) {
-    free(ctx->items);
-    free(ctx->last_items);
-    free(ctx->item_map);
-    free(ctx->data);
-    free(ctx);
+    // contexts created in place have no allocator
+    if (ctx->allocator.free) {
+        if (ctx->data_block)
+            ctx->allocator.free(ctx->allocator.user, ctx->data_block);
+        ctx->allocator.free(ctx->allocator.user, ctx);
+    }
 }
 
 void uiSetContextHandle(UIcontext *ui_context, void *handle) {
@@ -976,19 +2156,45 @@ void *uiGetContextHandle(UIcontext *ui_context) {
 }
 
 
-void uiSetButton(UIcontext *ui_context, unsigned int button, unsigned int mod, bool enabled) {
+static void uiChangeButton(UIcontext *ui_context, unsigned int button,
+        unsigned int mod, bool enabled, int timestamp, bool timed) {
     assert(ui_context);
     unsigned long long mask = 1ull<<button;
+    bool changed = ((ui_context->buttons & mask) != 0) != enabled;
+    if (!ui_context->button_time && changed)
+        ui_context->button_time = uiInputTime();
     // set new bit
     ui_context->buttons = (enabled)?
             (ui_context->buttons | mask):
             (ui_context->buttons & ~mask);
     ui_context->active_button_modifier = mod;
+    if (!changed)
+        return;
+    // queue the change for uiProcess(); if the queue is full, the last
+    // change is updated to keep the final state
+    if (ui_context->stepcount < UI_MAX_INPUT_EVENTS)
+        ui_context->stepcount++;
+    UIbuttonStep *step = &ui_context->steps[ui_context->stepcount - 1];
+    step->cursor = ui_context->cursor;
+    step->buttons = ui_context->buttons;
+    step->mod = mod;
+    step->timestamp = timestamp;
+    step->timed = timed;
+    step->time = uiInputTime();
+}
+
+void uiSetButton(UIcontext *ui_context, unsigned int button, unsigned int mod, bool enabled) {
+    uiChangeButton(ui_context, button, mod, enabled, 0, false);
+}
+
+void uiSetButtonAt(UIcontext *ui_context, unsigned int button, unsigned int mod, bool enabled, int timestamp) {
+    uiChangeButton(ui_context, button, mod, enabled, timestamp, true);
 }
 
 static void uiAddInputEvent(UIcontext *ui_context, UIinputEvent event) {
     assert(ui_context);
     if (ui_context->eventcount == UI_MAX_INPUT_EVENTS) return;
+    event.time = uiInputTime();
     ui_context->events[ui_context->eventcount++] = event;
 }
 
@@ -997,22 +2203,25 @@ static void uiClearInputEvents(UIcontext *ui_context) {
     ui_context->eventcount = 0;
     ui_context->scroll.x = 0;
     ui_context->scroll.y = 0;
+    ui_context->scroll_time = 0.0;
 }
 
 void uiSetKey(UIcontext *ui_context, unsigned int key, unsigned int mod, bool enabled) {
     assert(ui_context);
-    UIinputEvent event = { key, mod, enabled?UI_KEY_DOWN:UI_KEY_UP };
+    UIinputEvent event = { key, mod, enabled?UI_KEY_DOWN:UI_KEY_UP, 0.0 };
     uiAddInputEvent(ui_context, event);
 }
 
 void uiSetChar(UIcontext *ui_context, unsigned int value) {
     assert(ui_context);
-    UIinputEvent event = { value, 0, UI_CHAR };
+    UIinputEvent event = { value, 0, UI_CHAR, 0.0 };
     uiAddInputEvent(ui_context, event);
 }
 
 void uiSetScroll(UIcontext *ui_context, int x, int y) {
     assert(ui_context);
+    if (!ui_context->scroll_time && (x || y))
+        ui_context->scroll_time = uiInputTime();
     ui_context->scroll.x += x;
     ui_context->scroll.y += y;
 }
@@ -1043,9 +2252,34 @@ int uiButtonReleased(UIcontext *ui_context, unsigned int button) {
 }
 
 void uiSetCursor(UIcontext *ui_context, int x, int y) {
+    uiSetCursorSample(ui_context, x, y, 0.0);
+}
+
+void uiSetCursorSample(UIcontext *ui_context, int x, int y, double time) {
     assert(ui_context);
+    if ((x == ui_context->cursor.x) && (y == ui_context->cursor.y))
+        return;
+    if (!ui_context->cursor_time)
+        ui_context->cursor_time = uiInputTime();
     ui_context->cursor.x = x;
     ui_context->cursor.y = y;
+    if (ui_context->samplecount == UI_MAX_CURSOR_SAMPLES) {
+        // keep every other sample, starting with the first
+        int i;
+        for (i = 1; i < UI_MAX_CURSOR_SAMPLES / 2; ++i) {
+            ui_context->samples[i] = ui_context->samples[i * 2];
+        }
+        ui_context->samplecount = UI_MAX_CURSOR_SAMPLES / 2;
+    }
+    UIcursorSample *sample = &ui_context->samples[ui_context->samplecount++];
+    sample->pos = ui_context->cursor;
+    sample->time = time;
+}
+
+const UIcursorSample *uiGetCursorSamples(UIcontext *ui_context, int *count) {
+    assert(ui_context && count);
+    *count = ui_context->last_samplecount;
+    return ui_context->last_samples;
 }
 
 UIvec2 uiGetCursor(UIcontext *ui_context) {
@@ -1106,28 +2340,96 @@ UIitem *uiItemPtr(UIcontext *ui_context, int item) {
     return ui_context->items + item;
 }
 
-UIitem *uiLastItemPtr(UIcontext *ui_context, int item) {
-    assert(ui_context && (item >= 0) && (item < ui_context->last_count));
-    return ui_context->last_items + item;
+// returns the extended attributes of an item, or NULL if none are set
+UI_INLINE UIitemExt *uiExtPtr(UIcontext *ui_context, int item) {
+    int ext = ui_context->item_ext[item];
+    return (ext < 0)?NULL:(ui_context->exts + ext);
 }
 
-int uiGetHotItem(UIcontext *ui_context) {
-    assert(ui_context);
-    return ui_context->hot_item;
+// returns the extended attributes of an item, allocating them if required
+static UIitemExt *uiAllocExt(UIcontext *ui_context, int item) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    if (!pext) {
+        assert(ui_context->extcount < (int)ui_context->item_capacity);
+        ui_context->item_ext[item] = ui_context->extcount;
+        pext = ui_context->exts + ui_context->extcount++;
+        memset(pext, 0, sizeof(UIitemExt));
+        pext->item = item;
+    }
+    return pext;
 }
 
-void uiFocus(UIcontext *ui_context, int item) {
-    assert(ui_context && (item >= -1) && (item < ui_context->count));
-    assert(ui_context->stage != UI_STAGE_LAYOUT);
-    ui_context->focus_item = item;
+// returns the declared state of an item; retained items are modified apart
+// from their layouted state after uiEndLayout()
+UI_INLINE UIitem *uiSourcePtr(UIcontext *ui_context, int item) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    if (ui_context->retained && (ui_context->stage != UI_STAGE_LAYOUT))
+        return ui_context->source_items + item;
+    return ui_context->items + item;
 }
 
-static void uiValidateStateItems(UIcontext *ui_context) {
+UI_INLINE bool uiInItemList(const int *items, int count, int item) {
+    int i;
+    if (count > UI_MAX_RELAYOUT)
+        return true;
+    for (i = 0; i < count; ++i) {
+        if (items[i] == item)
+            return true;
+    }
+    return false;
+}
+
+// queue the layout of the parents of a retained item that has been
+// modified after uiEndLayout()
+static void uiMarkDirty(UIcontext *ui_context, int item) {
+    if (!ui_context->retained || (ui_context->stage == UI_STAGE_LAYOUT))
+        return;
+    // detached items are layouted when they are inserted again
+    if (item && (ui_context->parents[item] < 0))
+        return;
+    if (uiInItemList(ui_context->dirty, ui_context->dirtycount, item))
+        return;
+    if (ui_context->dirtycount < UI_MAX_RELAYOUT)
+        ui_context->dirty[ui_context->dirtycount] = item;
+    ui_context->dirtycount++;
+}
+
+// returns the first item in a list of siblings starting at item that is
+// not hidden, or -1
+UI_INLINE int uiSkipHidden(UIcontext *ui_context, int item) {
+    while ((item >= 0) && (uiItemPtr(ui_context, item)->flags & UI_ITEM_HIDDEN)) {
+        item = uiItemPtr(ui_context, item)->nextitem;
+    }
+    return item;
+}
+
+UIitem *uiLastItemPtr(UIcontext *ui_context, int item) {
+    assert(ui_context && (item >= 0) && (item < ui_context->last_count));
+    return ui_context->last_items + item;
+}
+
+int uiGetHotItem(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->hot_item;
+}
+
+void uiFocus(UIcontext *ui_context, int item) {
+    assert(ui_context && (item >= -1) && (item < ui_context->count));
+    assert(ui_context->stage != UI_STAGE_LAYOUT);
+    if (ui_context->focus_item != item)
+        ui_context->redraw = true;
+    ui_context->focus_item = item;
+}
+
+static void uiValidateStateItems(UIcontext *ui_context) {
     assert(ui_context);
     ui_context->last_hot_item = uiRecoverItem(ui_context, ui_context->last_hot_item);
     ui_context->active_item = uiRecoverItem(ui_context, ui_context->active_item);
     ui_context->focus_item = uiRecoverItem(ui_context, ui_context->focus_item);
     ui_context->last_click_item = uiRecoverItem(ui_context, ui_context->last_click_item);
+    if (ui_context->input_window > 0)
+        ui_context->input_window = uiRecoverItem(ui_context, ui_context->input_window);
 }
 
 int uiGetFocusedItem(UIcontext *ui_context) {
@@ -1136,11 +2438,22 @@ int uiGetFocusedItem(UIcontext *ui_context) {
 }
 
 
+void uiSetRetained(UIcontext *ui_context, bool enable) {
+    assert(ui_context);
+    ui_context->retained = enable;
+}
+
 void uiBeginLayout(UIcontext *ui_context) {
     assert(ui_context);
     assert(ui_context->stage == UI_STAGE_PROCESS); // must run uiEndLayout(), uiProcess() first
+#ifdef OUI_TRACE
+    uiTraceBeginItem("uiBeginLayout", -1);
+#endif
     uiClear(ui_context);
     ui_context->stage = UI_STAGE_LAYOUT;
+#ifdef OUI_TRACE
+    uiTraceEnd();
+#endif
 }
 
 void uiClearState(UIcontext *ui_context) {
@@ -1149,37 +2462,217 @@ void uiClearState(UIcontext *ui_context) {
     ui_context->active_item = -1;
     ui_context->focus_item = -1;
     ui_context->last_click_item = -1;
+    ui_context->drag_type = 0;
+    ui_context->drag_source = -1;
+    ui_context->drag_target = -1;
+    ui_context->drag_targetcount = 0;
 }
 
 int uiItem(UIcontext *ui_context) {
     assert(ui_context);
-    assert(ui_context->stage == UI_STAGE_LAYOUT); // must run between uiBeginLayout() and uiEndLayout()
+    // must run between uiBeginLayout() and uiEndLayout(), or in retained mode
+    assert(ui_context->retained || (ui_context->stage == UI_STAGE_LAYOUT));
     assert(ui_context->count < (int)ui_context->item_capacity);
     int idx = ui_context->count++;
     UIitem *item = uiItemPtr(ui_context, idx);
     memset(item, 0, sizeof(UIitem));
     item->firstkid = -1;
     item->nextitem = -1;
+    if (ui_context->stage != UI_STAGE_LAYOUT) {
+        ui_context->source_items[idx] = *item;
+#ifdef OUI_STATS
+        ui_context->costs[idx * 2] = ui_context->costs[idx * 2 + 1] = 0.0f;
+#endif
+    }
+    ui_context->parents[idx] = -1;
+    ui_context->item_ext[idx] = -1;
+    ui_context->moved[idx] = 0;
     return idx;
 }
 
+// pass an event to the handler or the event queue
+static void uiSendEvent(UIcontext *ui_context, int item, UIevent event) {
+    if (!ui_context->handler && !ui_context->queue_events)
+        return;
+    ui_context->redraw = true;
+    if (ui_context->queue_events) {
+        if (ui_context->queuecount == UI_MAX_QUEUED_EVENTS)
+            return;
+        UIeventRecord *record = &ui_context->queue[ui_context->queuecount++];
+        record->item = item;
+        record->event = event;
+        record->key = ui_context->active_key;
+        record->mod = ui_context->active_modifier;
+        record->cursor = ui_context->cursor;
+        return;
+    }
+#ifdef OUI_STATS
+    ui_context->stats.handlers++;
+#endif
+#ifdef OUI_TRACE
+    uiTraceBeginItem("handler", item);
+#endif
+    ui_context->handler(ui_context, item, event);
+#ifdef OUI_TRACE
+    uiTraceEnd();
+#endif
+}
+
 void uiNotifyItem(UIcontext *ui_context, int item, UIevent event) {
     assert(ui_context);
-    if (!ui_context->handler)
-        return;
     assert((event & UI_ITEM_EVENT_MASK) == event);
     UIitem *pitem = uiItemPtr(ui_context, item);
-    if (pitem->flags & event) {
-        ui_context->handler(ui_context, item, event);
+    if (pitem->flags & event)
+        uiSendEvent(ui_context, item, event);
+}
+
+// restore the heap order of the timers after the timer at index has been
+// decreased
+static void uiSiftTimerUp(UIcontext *ui_context, int index) {
+    UItimer *timers = ui_context->timers;
+    UItimer timer = timers[index];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (timers[parent].deadline <= timer.deadline)
+            break;
+        timers[index] = timers[parent];
+        index = parent;
+    }
+    timers[index] = timer;
+}
+
+// restore the heap order of the timers after the timer at index has been
+// increased
+static void uiSiftTimerDown(UIcontext *ui_context, int index) {
+    UItimer *timers = ui_context->timers;
+    UItimer timer = timers[index];
+    int count = ui_context->timercount;
+    while (true) {
+        int kid = index * 2 + 1;
+        if (kid >= count)
+            break;
+        if ((kid + 1 < count) && (timers[kid + 1].deadline < timers[kid].deadline))
+            kid++;
+        if (timer.deadline <= timers[kid].deadline)
+            break;
+        timers[index] = timers[kid];
+        index = kid;
+    }
+    timers[index] = timer;
+}
+
+int uiRequestTimer(UIcontext *ui_context, int item, int delay) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    assert(delay >= 0);
+    int deadline = ui_context->last_timestamp + delay;
+    bool fresh = (ui_context->stage == UI_STAGE_LAYOUT);
+    int i;
+    for (i = 0; i < ui_context->timercount; ++i) {
+        if ((ui_context->timers[i].item == item)
+                && (ui_context->timers[i].fresh == fresh)) {
+            if (deadline < ui_context->timers[i].deadline) {
+                ui_context->timers[i].deadline = deadline;
+                uiSiftTimerUp(ui_context, i);
+            }
+            return 1;
+        }
+    }
+    if (ui_context->timercount == UI_MAX_TIMERS)
+        return 0;
+    i = ui_context->timercount++;
+    ui_context->timers[i].deadline = deadline;
+    ui_context->timers[i].item = item;
+    ui_context->timers[i].fresh = fresh;
+    uiSiftTimerUp(ui_context, i);
+    return 1;
+}
+
+int uiGetTimerDeadline(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->timercount?ui_context->timers[0].deadline:-1;
+}
+
+// map the items of pending timers to the new frame; timers that end up on
+// the same item are merged
+static void uiValidateTimers(UIcontext *ui_context) {
+    int i, j, count = 0;
+    for (i = 0; i < ui_context->timercount; ++i) {
+        UItimer timer = ui_context->timers[i];
+        if (!timer.fresh)
+            timer.item = uiRecoverItem(ui_context, timer.item);
+        timer.fresh = false;
+        if (timer.item < 0)
+            continue;
+        for (j = 0; j < count; ++j) {
+            if (ui_context->timers[j].item == timer.item)
+                break;
+        }
+        if (j == count)
+            ui_context->timers[count++] = timer;
+        else if (timer.deadline < ui_context->timers[j].deadline)
+            ui_context->timers[j].deadline = timer.deadline;
+    }
+    ui_context->timercount = count;
+    for (i = count / 2 - 1; i >= 0; --i) {
+        uiSiftTimerDown(ui_context, i);
+    }
+}
+
+// send UI_TIMER events for all timers that have expired at timestamp
+static void uiProcessTimers(UIcontext *ui_context, int timestamp) {
+    // timers requested by the handlers expire in the next call at the earliest
+    UItimer expired[UI_MAX_TIMERS];
+    int i, count = 0;
+    while (ui_context->timercount
+            && (ui_context->timers[0].deadline <= timestamp)) {
+        expired[count++] = ui_context->timers[0];
+        ui_context->timers[0] = ui_context->timers[--ui_context->timercount];
+        uiSiftTimerDown(ui_context, 0);
+    }
+    for (i = 0; i < count; ++i) {
+        uiSendEvent(ui_context, expired[i].item, UI_TIMER);
+    }
+}
+
+// mark item and its declared subtree as moved; marked subtrees are skipped,
+// as they are marked entirely
+static void uiMarkMoved(UIcontext *ui_context, int item) {
+    if (ui_context->moved[item])
+        return;
+    ui_context->moved[item] = 1;
+    int kid = uiSourcePtr(ui_context, item)->firstkid;
+    while (kid >= 0) {
+        uiMarkMoved(ui_context, kid);
+        kid = uiSourcePtr(ui_context, kid)->nextitem;
     }
 }
 
+// mark the scroll views and transformed items and their subtrees, so that
+// queries on all other items can skip walking their parents
+static void uiUpdateMoved(UIcontext *ui_context) {
+    int i;
+    memset(ui_context->moved, 0, (size_t)ui_context->count);
+    for (i = 0; i < ui_context->extcount; ++i) {
+        UIitemExt *pext = ui_context->exts + i;
+        if (pext->flags & (UI_EXT_SCROLL|UI_EXT_TRANSFORM))
+            uiMarkMoved(ui_context, pext->item);
+    }
+}
+
+// mark a child inserted into a moved item after uiEndLayout()
+UI_INLINE void uiInheritMoved(UIcontext *ui_context, int child) {
+    int parent = ui_context->parents[child];
+    if ((parent >= 0) && ui_context->moved[parent])
+        uiMarkMoved(ui_context, child);
+}
+
+// returns the last declared child of item, including hidden items
 UI_INLINE int uiLastChild(UIcontext *ui_context, int item) {
-    item = uiFirstChild(ui_context, item);
+    item = uiSourcePtr(ui_context, item)->firstkid;
     if (item < 0)
         return -1;
     while (true) {
-        int nextitem = uiNextSibling(ui_context, item);
+        int nextitem = uiSourcePtr(ui_context, item)->nextitem;
         if (nextitem < 0)
             return item;
         item = nextitem;
@@ -1188,23 +2681,26 @@ UI_INLINE int uiLastChild(UIcontext *ui_context, int item) {
 
 int uiAppend(UIcontext *ui_context, int item, int sibling) {
     assert(sibling > 0);
-    UIitem *pitem = uiItemPtr(ui_context, item);
-    UIitem *psibling = uiItemPtr(ui_context, sibling);
-    assert(!(psibling->flags & UI_ITEM_INSERTED));
+    UIitem *pitem = uiSourcePtr(ui_context, item);
+    UIitem *psibling = uiSourcePtr(ui_context, sibling);
+    assert(ui_context->parents[sibling] < 0); // must not be inserted yet
     psibling->nextitem = pitem->nextitem;
-    psibling->flags |= UI_ITEM_INSERTED;
     pitem->nextitem = sibling;
+    ui_context->parents[sibling] = ui_context->parents[item];
+    uiInheritMoved(ui_context, sibling);
+    uiMarkDirty(ui_context, sibling);
     return sibling;
 }
 
 int uiInsert(UIcontext *ui_context, int item, int child) {
-    assert(child > 0);
-    UIitem *pparent = uiItemPtr(ui_context, item);
-    UIitem *pchild = uiItemPtr(ui_context, child);
-    assert(!(pchild->flags & UI_ITEM_INSERTED));
+    assert((child > 0) && (child < ui_context->count));
+    UIitem *pparent = uiSourcePtr(ui_context, item);
+    assert(ui_context->parents[child] < 0); // must not be inserted yet
     if (pparent->firstkid < 0) {
         pparent->firstkid = child;
-        pchild->flags |= UI_ITEM_INSERTED;
+        ui_context->parents[child] = item;
+        uiInheritMoved(ui_context, child);
+        uiMarkDirty(ui_context, child);
     } else {
         uiAppend(ui_context, uiLastChild(ui_context, item), child);
     }
@@ -1217,25 +2713,71 @@ int uiInsertFront(UIcontext *ui_context, int item, int child) {
 
 int uiInsertBack(UIcontext *ui_context, int item, int child) {
     assert(child > 0);
-    UIitem *pparent = uiItemPtr(ui_context, item);
-    UIitem *pchild = uiItemPtr(ui_context, child);
-    assert(!(pchild->flags & UI_ITEM_INSERTED));
+    UIitem *pparent = uiSourcePtr(ui_context, item);
+    UIitem *pchild = uiSourcePtr(ui_context, child);
+    assert(ui_context->parents[child] < 0); // must not be inserted yet
     pchild->nextitem = pparent->firstkid;
     pparent->firstkid = child;
-    pchild->flags |= UI_ITEM_INSERTED;
+    ui_context->parents[child] = item;
+    uiInheritMoved(ui_context, child);
+    uiMarkDirty(ui_context, child);
     return child;
 }
 
+void uiRemove(UIcontext *ui_context, int item) {
+    assert(item > 0);
+    int parent = ui_context->parents[item];
+    if (parent < 0)
+        return;
+    UIitem *pitem = uiSourcePtr(ui_context, item);
+    UIitem *pparent = uiSourcePtr(ui_context, parent);
+    // the layout boundary of a detached item can not be found; a sibling
+    // shares it, and without siblings the parent has to be layouted again
+    int sibling = (pparent->firstkid != item)?pparent->firstkid:pitem->nextitem;
+    uiMarkDirty(ui_context, (sibling >= 0)?sibling:parent);
+    if (pparent->firstkid == item) {
+        pparent->firstkid = pitem->nextitem;
+    } else {
+        UIitem *pkid = uiSourcePtr(ui_context, pparent->firstkid);
+        while (pkid->nextitem != item) {
+            pkid = uiSourcePtr(ui_context, pkid->nextitem);
+        }
+        pkid->nextitem = pitem->nextitem;
+    }
+    pitem->nextitem = -1;
+    ui_context->parents[item] = -1;
+}
+
+// after uiEndLayout(), retained items keep attributes that do not affect
+// the layout in both their declared and layouted state
+UI_INLINE void uiSyncFlags(UIcontext *ui_context, int item, unsigned int mask) {
+    if (ui_context->retained && (ui_context->stage != UI_STAGE_LAYOUT)) {
+        UIitem *psource = ui_context->source_items + item;
+        psource->flags &= ~mask;
+        psource->flags |= uiItemPtr(ui_context, item)->flags & mask;
+    }
+}
+
 void uiSetFrozen(UIcontext *ui_context, int item, bool enable) {
     UIitem *pitem = uiItemPtr(ui_context, item);
     if (enable)
         pitem->flags |= UI_ITEM_FROZEN;
     else
         pitem->flags &= ~UI_ITEM_FROZEN;
+    uiSyncFlags(ui_context, item, UI_ITEM_FROZEN);
+}
+
+void uiSetHidden(UIcontext *ui_context, int item, bool enable) {
+    UIitem *pitem = uiSourcePtr(ui_context, item);
+    if (enable)
+        pitem->flags |= UI_ITEM_HIDDEN;
+    else
+        pitem->flags &= ~UI_ITEM_HIDDEN;
+    uiMarkDirty(ui_context, item);
 }
 
 void uiSetSize(UIcontext *ui_context, int item, int w, int h) {
-    UIitem *pitem = uiItemPtr(ui_context, item);
+    UIitem *pitem = uiSourcePtr(ui_context, item);
     pitem->size[0] = w;
     pitem->size[1] = h;
     if (!w)
@@ -1246,6 +2788,7 @@ void uiSetSize(UIcontext *ui_context, int item, int w, int h) {
         pitem->flags &= ~UI_ITEM_VFIXED;
     else
         pitem->flags |= UI_ITEM_VFIXED;
+    uiMarkDirty(ui_context, item);
 }
 
 int uiGetWidth(UIcontext *ui_context, int item) {
@@ -1257,10 +2800,11 @@ int uiGetHeight(UIcontext *ui_context, int item) {
 }
 
 void uiSetLayout(UIcontext *ui_context, int item, unsigned int flags) {
-    UIitem *pitem = uiItemPtr(ui_context, item);
+    UIitem *pitem = uiSourcePtr(ui_context, item);
     assert((flags & UI_ITEM_LAYOUT_MASK) == (unsigned int)flags);
     pitem->flags &= ~UI_ITEM_LAYOUT_MASK;
     pitem->flags |= flags & UI_ITEM_LAYOUT_MASK;
+    uiMarkDirty(ui_context, item);
 }
 
 unsigned int uiGetLayout(UIcontext *ui_context, int item) {
@@ -1268,10 +2812,13 @@ unsigned int uiGetLayout(UIcontext *ui_context, int item) {
 }
 
 void uiSetBox(UIcontext *ui_context, int item, unsigned int flags) {
-    UIitem *pitem = uiItemPtr(ui_context, item);
+    UIitem *pitem = uiSourcePtr(ui_context, item);
     assert((flags & UI_ITEM_BOX_MASK) == (unsigned int)flags);
     pitem->flags &= ~UI_ITEM_BOX_MASK;
     pitem->flags |= flags & UI_ITEM_BOX_MASK;
+    if ((flags & UI_ITEM_BOX_MODEL_MASK) == (UI_COLUMN|UI_WRAP))
+        ui_context->has_column_wraps = true;
+    uiMarkDirty(ui_context, item);
 }
 
 unsigned int uiGetBox(UIcontext *ui_context, int item) {
@@ -1279,11 +2826,12 @@ unsigned int uiGetBox(UIcontext *ui_context, int item) {
 }
 
 void uiSetMargins(UIcontext *ui_context, int item, short l, short t, short r, short b) {
-    UIitem *pitem = uiItemPtr(ui_context, item);
+    UIitem *pitem = uiSourcePtr(ui_context, item);
     pitem->margins[0] = l;
     pitem->margins[1] = t;
     pitem->margins[2] = r;
     pitem->margins[3] = b;
+    uiMarkDirty(ui_context, item);
 }
 
 short uiGetMarginLeft(UIcontext *ui_context, int item) {
@@ -1299,12 +2847,223 @@ short uiGetMarginDown(UIcontext *ui_context, int item) {
     return uiItemPtr(ui_context, item)->margins[3];
 }
 
+void uiSetScrollOffset(UIcontext *ui_context, int item, int x, int y) {
+    UIitemExt *pext;
+    if (ui_context->stage == UI_STAGE_LAYOUT) {
+        pext = uiAllocExt(ui_context, item);
+        pext->flags |= UI_EXT_SCROLL;
+    } else {
+        // scroll views must be declared before uiEndLayout()
+        pext = uiExtPtr(ui_context, item);
+        assert(pext && (pext->flags & UI_EXT_SCROLL));
+    }
+    pext->scroll[0] = x;
+    pext->scroll[1] = y;
+}
+
+void uiSetMeasure(UIcontext *ui_context, int item, UImeasure measure) {
+    UIitemExt *pext = uiAllocExt(ui_context, item);
+    pext->flags &= ~(UI_EXT_MEASURE|UI_EXT_MEASURED);
+    if (measure)
+        pext->flags |= UI_EXT_MEASURE;
+    pext->measure = measure;
+    uiMarkDirty(ui_context, item);
+}
+
+void uiSetMinSize(UIcontext *ui_context, int item, int w, int h) {
+    UIitemExt *pext = uiAllocExt(ui_context, item);
+    pext->flags |= UI_EXT_LIMITS;
+    pext->minsize[0] = w;
+    pext->minsize[1] = h;
+    uiMarkDirty(ui_context, item);
+}
+
+void uiSetMaxSize(UIcontext *ui_context, int item, int w, int h) {
+    UIitemExt *pext = uiAllocExt(ui_context, item);
+    pext->flags |= UI_EXT_LIMITS;
+    pext->maxsize[0] = w;
+    pext->maxsize[1] = h;
+    uiMarkDirty(ui_context, item);
+}
+
+void uiSetLayer(UIcontext *ui_context, int item, int z, bool opaque) {
+    assert(item > 0);
+    UIitemExt *pext = uiAllocExt(ui_context, item);
+    int i = ui_context->layercount;
+    if (pext->flags & UI_EXT_LAYER) {
+        // declared again; take the layer out of the list
+        for (i = 0; ui_context->layers[i] != item; ++i) {}
+        ui_context->layercount--;
+        for (; i < ui_context->layercount; ++i)
+            ui_context->layers[i] = ui_context->layers[i + 1];
+    }
+    assert(ui_context->layercount < UI_MAX_LAYERS);
+    if (ui_context->layercount == UI_MAX_LAYERS)
+        return;
+    pext->flags |= UI_EXT_LAYER;
+    if (opaque)
+        pext->flags |= UI_EXT_OPAQUE;
+    else
+        pext->flags &= ~UI_EXT_OPAQUE;
+    pext->layer = z;
+    // insert after all layers of equal or lower z
+    i = ui_context->layercount++;
+    while ((i > 0) && (uiExtPtr(ui_context, ui_context->layers[i - 1])->layer > z)) {
+        ui_context->layers[i] = ui_context->layers[i - 1];
+        i--;
+    }
+    ui_context->layers[i] = item;
+}
+
+void uiSetWindow(UIcontext *ui_context, int item, int w, int h) {
+    assert(item > 0);
+    uiAllocExt(ui_context, item)->flags |= UI_EXT_WINDOW;
+    uiSetLayout(ui_context, item, UI_LEFT|UI_TOP);
+    uiSetMargins(ui_context, item, 0, 0, 0, 0);
+    uiSetSize(ui_context, item, w, h);
+}
+
+UI_INLINE bool uiIsWindow(UIcontext *ui_context, int item) {
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    return pext && (pext->flags & UI_EXT_WINDOW);
+}
+
+void uiSetInputWindow(UIcontext *ui_context, int item) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    assert(ui_context->stage != UI_STAGE_LAYOUT);
+    assert(!item || uiIsWindow(ui_context, item));
+    ui_context->input_window = item;
+}
+
+int uiGetInputWindow(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->input_window;
+}
+
+// returns true if item and all its parents are attached to the root and
+// can be hit
+static bool uiIsReachable(UIcontext *ui_context, int item) {
+    while (item > 0) {
+        if (uiItemPtr(ui_context, item)->flags & (UI_ITEM_FROZEN|UI_ITEM_HIDDEN))
+            return false;
+        item = ui_context->parents[item];
+    }
+    return !item;
+}
+
+// returns true if item is part of the window that receives input
+static bool uiInInputWindow(UIcontext *ui_context, int item) {
+    int window = ui_context->input_window;
+    if (!window)
+        return true;
+    while ((item > 0) && (item != window)) {
+        item = ui_context->parents[item];
+    }
+    return item == window;
+}
+
+int uiGetLayerCount(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->layercount;
+}
+
+int uiGetLayer(UIcontext *ui_context, int index) {
+    assert(ui_context && (index >= 0) && (index < ui_context->layercount));
+    return ui_context->layers[index];
+}
+
+int uiIsLayer(UIcontext *ui_context, int item) {
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    return (pext && (pext->flags & UI_EXT_LAYER))?1:0;
+}
+
+// add item and its children that accept the current drag to the drop
+// targets, in the order in which uiFindItem() prefers them
+static void uiCollectDropTargets(UIcontext *ui_context, int item) {
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    if (pitem->flags & (UI_ITEM_FROZEN|UI_ITEM_HIDDEN))
+        return;
+    if (pitem->flags & ui_context->drag_type) {
+        if (ui_context->drag_targetcount < UI_MAX_DROP_TARGETS)
+            ui_context->drag_targets[ui_context->drag_targetcount] = item;
+        ui_context->drag_targetcount++;
+    }
+    int kid = uiFirstChild(ui_context, item);
+    while (kid >= 0) {
+        if (!ui_context->layercount || !uiIsLayer(ui_context, kid))
+            uiCollectDropTargets(ui_context, kid);
+        kid = uiNextSibling(ui_context, kid);
+    }
+}
+
+// collect the drop targets of the current drag within the window that
+// receives input, with the targets of each layer after those below
+static void uiBuildDropTargets(UIcontext *ui_context) {
+    int i;
+    ui_context->drag_targetcount = 0;
+    if (!ui_context->drag_type || !ui_context->count
+            || (ui_context->input_window < 0))
+        return;
+    uiCollectDropTargets(ui_context, ui_context->input_window);
+    for (i = 0; i < ui_context->layercount; ++i) {
+        int layer = ui_context->layers[i];
+        ui_context->drag_layerstart[i] = ui_context->drag_targetcount;
+        if (uiIsReachable(ui_context, layer)
+                && uiInInputWindow(ui_context, layer))
+            uiCollectDropTargets(ui_context, layer);
+    }
+}
+
+void uiSetTransform(UIcontext *ui_context, int item, float x, float y, float scale) {
+    UIitemExt *pext = uiAllocExt(ui_context, item);
+    // during layouting, items are marked by uiEndLayout()
+    if (!(pext->flags & UI_EXT_TRANSFORM)
+            && (ui_context->stage != UI_STAGE_LAYOUT))
+        uiMarkMoved(ui_context, item);
+    pext->flags |= UI_EXT_TRANSFORM;
+    pext->offset[0] = x;
+    pext->offset[1] = y;
+    pext->scale = scale;
+}
+
+UIvec2 uiGetScrollOffset(UIcontext *ui_context, int item) {
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    UIvec2 result = {{{ 0, 0 }}};
+    if (pext && (pext->flags & UI_EXT_SCROLL)) {
+        result.x = pext->scroll[0];
+        result.y = pext->scroll[1];
+    }
+    return result;
+}
+
+UIvec2 uiGetContentSize(UIcontext *ui_context, int item) {
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    UIvec2 result = {{{ pitem->size[0], pitem->size[1] }}};
+    if (pext && (pext->flags & UI_EXT_SCROLL)) {
+        result.x = pext->content[0];
+        result.y = pext->content[1];
+    }
+    return result;
+}
+
+UI_INLINE UIitemExt *uiLimitsPtr(UIcontext *ui_context, int item) {
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    return (pext && (pext->flags & UI_EXT_LIMITS))?pext:NULL;
+}
+
+UI_INLINE float uiClampSize(UIitemExt *pext, int dim, float size) {
+    if (pext->maxsize[dim] && (size > (float)pext->maxsize[dim]))
+        size = (float)pext->maxsize[dim];
+    return ui_maxf(size, (float)pext->minsize[dim]);
+}
+
 // compute bounding box of all items super-imposed
 UI_INLINE void uiComputeImposedSize(UIcontext *ui_context, UIitem *pitem, int dim) {
     int wdim = dim+2;
     // largest size is required size
     short need_size = 0;
-    int kid = pitem->firstkid;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
     while (kid >= 0) {
         UIitem *pkid = uiItemPtr(ui_context, kid);
 
@@ -1320,7 +3079,7 @@ UI_INLINE void uiComputeImposedSize(UIcontext *ui_context, UIitem *pitem, int di
 UI_INLINE void uiComputeStackedSize(UIcontext *ui_context, UIitem *pitem, int dim) {
     int wdim = dim+2;
     short need_size = 0;
-    int kid = pitem->firstkid;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
     while (kid >= 0) {
         UIitem *pkid = uiItemPtr(ui_context, kid);
         // width += start margin + calculated width + end margin
@@ -1336,7 +3095,7 @@ UI_INLINE void uiComputeWrappedStackedSize(UIcontext *ui_context, UIitem *pitem,
 
     short need_size = 0;
     short need_size2 = 0;
-    int kid = pitem->firstkid;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
     while (kid >= 0) {
         UIitem *pkid = uiItemPtr(ui_context, kid);
 
@@ -1360,7 +3119,7 @@ UI_INLINE void uiComputeWrappedSize(UIcontext *ui_context, UIitem *pitem, int di
 
     short need_size = 0;
     short need_size2 = 0;
-    int kid = pitem->firstkid;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
     while (kid >= 0) {
         UIitem *pkid = uiItemPtr(ui_context, kid);
 
@@ -1379,18 +3138,50 @@ UI_INLINE void uiComputeWrappedSize(UIcontext *ui_context, UIitem *pitem, int di
     pitem->size[dim] = need_size2 + need_size;
 }
 
-static void uiComputeSize(UIcontext *ui_context, int item, int dim) {
-    UIitem *pitem = uiItemPtr(ui_context, item);
+// compute the size of each grid track (column for dim 0, row for dim 1)
+// into the tracks buffer and return the number of tracks
+static int uiComputeGridTracks(UIcontext *ui_context, UIitem *pitem, int dim) {
+    int wdim = dim+2;
+    short *tracks = ui_context->tracks;
 
-    // children expand the size
-    int kid = pitem->firstkid;
+    int count = 0;
+    int col = 0;
+    int row = 0;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
     while (kid >= 0) {
-        uiComputeSize(ui_context, kid, dim);
+        UIitem *pkid = uiItemPtr(ui_context, kid);
+
+        // a break starts a new row
+        if (col && (pkid->flags & UI_BREAK)) {
+            row++;
+            col = 0;
+        }
+
+        int track = dim?row:col;
+        if (track == count) {
+            tracks[count++] = 0;
+        }
+        // width = start margin + calculated width + end margin
+        int kidsize = pkid->margins[dim] + pkid->size[dim] + pkid->margins[wdim];
+        tracks[track] = ui_max(tracks[track], kidsize);
+        col++;
         kid = uiNextSibling(ui_context, kid);
     }
+    return count;
+}
 
-    if (pitem->size[dim])
-        return;
+// compute bounding box of all tracks of a grid
+static void uiComputeGridSize(UIcontext *ui_context, UIitem *pitem, int dim) {
+    int count = uiComputeGridTracks(ui_context, pitem, dim);
+    short need_size = 0;
+    int i;
+    for (i = 0; i < count; ++i) {
+        need_size += ui_context->tracks[i];
+    }
+    pitem->size[dim] = need_size;
+}
+
+UI_INLINE void uiComputeBoxSize(UIcontext *ui_context, UIitem *pitem, int dim) {
     switch(pitem->flags & UI_ITEM_BOX_MODEL_MASK) {
     case UI_COLUMN|UI_WRAP: {
         // flex model
@@ -1414,6 +3205,10 @@ static void uiComputeSize(UIcontext *ui_context, int item, int dim) {
         else
             uiComputeImposedSize(ui_context, pitem, dim);
     } break;
+    case UI_GRID: {
+        // grid model
+        uiComputeGridSize(ui_context, pitem, dim);
+    } break;
     default: {
         // layout model
         uiComputeImposedSize(ui_context, pitem, dim);
@@ -1421,14 +3216,196 @@ static void uiComputeSize(UIcontext *ui_context, int item, int dim) {
     }
 }
 
+static void uiComputeSize(UIcontext *ui_context, int item, int dim) {
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    double start = uiBeginCost(ui_context);
+
+    // children expand the size
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
+    while (kid >= 0) {
+        uiComputeSize(ui_context, kid, dim);
+        kid = uiNextSibling(ui_context, kid);
+    }
+
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    if (pext && (pext->flags & UI_EXT_SCROLL)) {
+        // the content of a scroll view is measured even if the size
+        // of the view is fixed
+        short size = pitem->size[dim];
+        pitem->size[dim] = 0;
+        uiComputeBoxSize(ui_context, pitem, dim);
+        pext->content[dim] = pitem->size[dim];
+        if (size)
+            pitem->size[dim] = size;
+    } else if (!pitem->size[dim]) {
+        uiComputeBoxSize(ui_context, pitem, dim);
+    }
+
+    if (pext && (pext->flags & UI_EXT_LIMITS))
+        pitem->size[dim] = (short)uiClampSize(pext, dim, pitem->size[dim]);
+    uiEndCost(ui_context, item, UI_PHASE_COMPUTE, start);
+}
+
+// distribute space among count growing or shrinking items; items in the
+// clamped list that would exceed their limits are clamped, and the space
+// they can not take is distributed among the remaining items. Returns the
+// share of each item that has not been clamped.
+UI_INLINE float uiResolveLimits(UIcontext *ui_context, int clamped, int dim,
+        float space, int count, bool grow) {
+    float share = space / (float)count;
+    while (count) {
+        // sum up by how much clamping changes the size of the items
+        float violation = 0.0f;
+        bool violated = false;
+        int ext = clamped;
+        while (ext >= 0) {
+            UIitemExt *pext = &ui_context->exts[ext];
+            if (!(pext->flags & UI_EXT_CLAMPED)) {
+                float base = grow?0.0f:(float)uiItemPtr(ui_context, pext->item)->size[dim];
+                float size = ui_maxf(0.0f, base + share);
+                float limit = uiClampSize(pext, dim, size);
+                violated = violated || (limit != size);
+                violation += limit - size;
+            }
+            ext = pext->next_clamped;
+        }
+        if (!violated)
+            break;
+
+        // clamp all items that are pushed in the same direction, or all
+        // items if the violations cancel out
+        ext = clamped;
+        while (ext >= 0) {
+            UIitemExt *pext = &ui_context->exts[ext];
+            if (!(pext->flags & UI_EXT_CLAMPED)) {
+                float base = grow?0.0f:(float)uiItemPtr(ui_context, pext->item)->size[dim];
+                float size = ui_maxf(0.0f, base + share);
+                float limit = uiClampSize(pext, dim, size);
+                if ((violation > 0.0f)?(limit > size):
+                        ((violation < 0.0f)?(limit < size):(limit != size))) {
+                    pext->flags |= UI_EXT_CLAMPED;
+                    space -= limit - base;
+                    count--;
+                }
+            }
+            ext = pext->next_clamped;
+        }
+        if (count)
+            share = space / (float)count;
+    }
+    return share;
+}
+
 // stack all items according to their alignment
+#if defined(UI_SIMD_SSE2) || defined(UI_SIMD_NEON)
+// first pass of uiArrangeStacked() for a line that does not wrap, four
+// siblings at a time: counts fillers, squeezable and all items, and adds up
+// the used space of consecutively declared, visible siblings without
+// extended attributes, starting at kid. returns the first sibling that has
+// not been counted, or -1. used wraps around like the short in the scalar
+// loop, so the results are identical.
+UI_INLINE int uiCountStackedRun(UIcontext *ui_context, int kid, int dim,
+        short *used, int *count, int *squeezed_count, int *total) {
+    int wdim = dim+2;
+    unsigned int flags[4];
+    int extends[4];
+    int sizes[4];
+    int sums[4];
+    int i;
+#ifdef UI_SIMD_SSE2
+    __m128i vcount = _mm_setzero_si128();
+    __m128i vsqueezed = _mm_setzero_si128();
+    __m128i vused = _mm_setzero_si128();
+    __m128i shift = _mm_cvtsi32_si128(dim);
+#else
+    int32x4_t vcount = vdupq_n_s32(0);
+    int32x4_t vsqueezed = vdupq_n_s32(0);
+    int32x4_t vused = vdupq_n_s32(0);
+    int32x4_t shift = vdupq_n_s32(-dim);
+#endif
+    while ((kid >= 0) && (kid + 4 <= ui_context->count)) {
+        const UIitem *pkids = ui_context->items + kid;
+        if ((pkids[0].nextitem != kid + 1)
+                || (pkids[1].nextitem != kid + 2)
+                || (pkids[2].nextitem != kid + 3))
+            break;
+        for (i = 0; i < 4; ++i) {
+            flags[i] = pkids[i].flags;
+            extends[i] = pkids[i].margins[dim] + pkids[i].margins[wdim];
+            sizes[i] = pkids[i].size[dim];
+        }
+#ifdef UI_SIMD_SSE2
+        __m128i vext = _mm_loadu_si128((const __m128i *)(ui_context->item_ext + kid));
+        __m128i vflags = _mm_loadu_si128((const __m128i *)flags);
+        __m128i stop = _mm_or_si128(
+            _mm_andnot_si128(_mm_cmpeq_epi32(vext, _mm_set1_epi32(-1)),
+                _mm_set1_epi32(-1)),
+            _mm_and_si128(vflags, _mm_set1_epi32(UI_ITEM_HIDDEN)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(stop, _mm_setzero_si128())) != 0xffff)
+            break;
+        __m128i hfill = _mm_set1_epi32(UI_HFILL);
+        __m128i hfixed = _mm_set1_epi32(UI_ITEM_HFIXED);
+        __m128i fill = _mm_cmpeq_epi32(hfill, _mm_and_si128(hfill, _mm_srl_epi32(
+            _mm_and_si128(vflags, _mm_set1_epi32(UI_ITEM_LAYOUT_MASK)), shift)));
+        __m128i fixed = _mm_cmpeq_epi32(hfixed, _mm_and_si128(hfixed, _mm_srl_epi32(
+            _mm_and_si128(vflags, _mm_set1_epi32(UI_ITEM_FIXED_MASK)), shift)));
+        vcount = _mm_sub_epi32(vcount, fill);
+        vsqueezed = _mm_sub_epi32(vsqueezed,
+            _mm_andnot_si128(_mm_or_si128(fill, fixed), _mm_set1_epi32(-1)));
+        vused = _mm_add_epi32(vused, _mm_add_epi32(
+            _mm_loadu_si128((const __m128i *)extends),
+            _mm_andnot_si128(fill, _mm_loadu_si128((const __m128i *)sizes))));
+#else
+        uint32x4_t vext = vreinterpretq_u32_s32(vld1q_s32(ui_context->item_ext + kid));
+        uint32x4_t vflags = vld1q_u32(flags);
+        uint32x4_t stop = vorrq_u32(
+            vmvnq_u32(vceqq_u32(vext, vdupq_n_u32(0xffffffff))),
+            vandq_u32(vflags, vdupq_n_u32(UI_ITEM_HIDDEN)));
+        uint32x2_t stop2 = vorr_u32(vget_low_u32(stop), vget_high_u32(stop));
+        if (vget_lane_u32(vpmax_u32(stop2, stop2), 0))
+            break;
+        uint32x4_t hfill = vdupq_n_u32(UI_HFILL);
+        uint32x4_t hfixed = vdupq_n_u32(UI_ITEM_HFIXED);
+        uint32x4_t fill = vceqq_u32(hfill, vandq_u32(hfill, vshlq_u32(
+            vandq_u32(vflags, vdupq_n_u32(UI_ITEM_LAYOUT_MASK)), shift)));
+        uint32x4_t fixed = vceqq_u32(hfixed, vandq_u32(hfixed, vshlq_u32(
+            vandq_u32(vflags, vdupq_n_u32(UI_ITEM_FIXED_MASK)), shift)));
+        vcount = vsubq_s32(vcount, vreinterpretq_s32_u32(fill));
+        vsqueezed = vsubq_s32(vsqueezed,
+            vreinterpretq_s32_u32(vmvnq_u32(vorrq_u32(fill, fixed))));
+        vused = vaddq_s32(vused, vaddq_s32(vld1q_s32(extends),
+            vreinterpretq_s32_u32(vbicq_u32(
+                vreinterpretq_u32_s32(vld1q_s32(sizes)), fill))));
+#endif
+        *total += 4;
+        kid = uiSkipHidden(ui_context, pkids[3].nextitem);
+    }
+#ifdef UI_SIMD_SSE2
+    _mm_storeu_si128((__m128i *)sums, vcount);
+    *count += sums[0] + sums[1] + sums[2] + sums[3];
+    _mm_storeu_si128((__m128i *)sums, vsqueezed);
+    *squeezed_count += sums[0] + sums[1] + sums[2] + sums[3];
+    _mm_storeu_si128((__m128i *)sums, vused);
+#else
+    vst1q_s32(sums, vcount);
+    *count += sums[0] + sums[1] + sums[2] + sums[3];
+    vst1q_s32(sums, vsqueezed);
+    *squeezed_count += sums[0] + sums[1] + sums[2] + sums[3];
+    vst1q_s32(sums, vused);
+#endif
+    *used = (short)(unsigned short)((unsigned int)*used + (unsigned int)sums[0]
+        + (unsigned int)sums[1] + (unsigned int)sums[2] + (unsigned int)sums[3]);
+    return kid;
+}
+#endif
+
 UI_INLINE void uiArrangeStacked(UIcontext *ui_context, UIitem *pitem, int dim, bool wrap) {
     int wdim = dim+2;
 
     short space = pitem->size[dim];
     float max_x2 = (float)pitem->margins[dim] + (float)space;
 
-    int start_kid = pitem->firstkid;
+    int start_kid = uiSkipHidden(ui_context, pitem->firstkid);
     while (start_kid >= 0) {
         short used = 0;
 
@@ -1436,18 +3413,35 @@ UI_INLINE void uiArrangeStacked(UIcontext *ui_context, UIitem *pitem, int dim, b
         int squeezed_count = 0; // count of squeezable elements
         int total = 0;
         bool hardbreak = false;
+        // fillers and squeezable elements with limits
+        int fill_clamped = -1;
+        int squeeze_clamped = -1;
+        short fill_min = 0;
         // first pass: count items that need to be expanded,
         // and the space that is used
         int kid = start_kid;
         int end_kid = -1;
         while (kid >= 0) {
+#if defined(UI_SIMD_SSE2) || defined(UI_SIMD_NEON)
+            // runs of plain siblings are counted four at a time
+            if (!wrap) {
+                kid = uiCountStackedRun(ui_context, kid, dim,
+                    &used, &count, &squeezed_count, &total);
+                if (kid < 0)
+                    break;
+            }
+#endif
             UIitem *pkid = uiItemPtr(ui_context, kid);
             int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
             int fflags = (pkid->flags & UI_ITEM_FIXED_MASK) >> dim;
+            UIitemExt *pext = uiLimitsPtr(ui_context, kid);
             short extend = used;
             if ((flags & UI_HFILL) == UI_HFILL) { // grow
                 count++;
                 extend += pkid->margins[dim] + pkid->margins[wdim];
+                // fillers take at least their minimum size
+                if (pext)
+                    extend += pext->minsize[dim];
             } else {
                 if ((fflags & UI_ITEM_HFIXED) != UI_ITEM_HFIXED)
                     squeezed_count++;
@@ -1462,6 +3456,17 @@ UI_INLINE void uiArrangeStacked(UIcontext *ui_context, UIitem *pitem, int dim, b
                 break;
             } else {
                 used = extend;
+                if (pext) {
+                    pext->flags &= ~UI_EXT_CLAMPED;
+                    if ((flags & UI_HFILL) == UI_HFILL) {
+                        fill_min += pext->minsize[dim];
+                        pext->next_clamped = fill_clamped;
+                        fill_clamped = ui_context->item_ext[kid];
+                    } else if ((fflags & UI_ITEM_HFIXED) != UI_ITEM_HFIXED) {
+                        pext->next_clamped = squeeze_clamped;
+                        squeeze_clamped = ui_context->item_ext[kid];
+                    }
+                }
                 kid = uiNextSibling(ui_context, kid);
             }
             total++;
@@ -1474,7 +3479,10 @@ UI_INLINE void uiArrangeStacked(UIcontext *ui_context, UIitem *pitem, int dim, b
         float eater = 0.0f;
 
         if (extra_space > 0) {
-            if (count) {
+            if (fill_clamped >= 0) {
+                filler = uiResolveLimits(ui_context, fill_clamped, dim,
+                    (float)(extra_space + fill_min), count, true);
+            } else if (count) {
                 filler = (float)extra_space / (float)count;
             } else if (total) {
                 switch(pitem->flags & UI_JUSTIFY) {
@@ -1495,8 +3503,14 @@ UI_INLINE void uiArrangeStacked(UIcontext *ui_context, UIitem *pitem, int dim, b
                 }
             }
         } else if (!wrap && (extra_space < 0)) {
-           eater = (float)extra_space / (float)squeezed_count;
+            if (squeeze_clamped >= 0) {
+                eater = uiResolveLimits(ui_context, squeeze_clamped, dim,
+                    (float)extra_space, squeezed_count, false);
+            } else {
+                eater = (float)extra_space / (float)squeezed_count;
+            }
         }
+        bool limits = (fill_clamped >= 0) || (squeeze_clamped >= 0);
 
         // distribute width among items
         float x = (float)pitem->margins[dim];
@@ -1509,14 +3523,17 @@ UI_INLINE void uiArrangeStacked(UIcontext *ui_context, UIitem *pitem, int dim, b
             int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
             int fflags = (pkid->flags & UI_ITEM_FIXED_MASK) >> dim;
 
+            UIitemExt *pext = limits?uiLimitsPtr(ui_context, kid):NULL;
+
             x += (float)pkid->margins[dim] + extra_margin;
             if ((flags & UI_HFILL) == UI_HFILL) { // grow
-                x1 = x+filler;
+                x1 = x+(pext?uiClampSize(pext, dim, filler):filler);
             } else if ((fflags & UI_ITEM_HFIXED) == UI_ITEM_HFIXED) {
                 x1 = x+(float)pkid->size[dim];
             } else {
                 // squeeze
-                x1 = x+ui_maxf(0.0f,(float)pkid->size[dim]+eater);
+                float size = ui_maxf(0.0f,(float)pkid->size[dim]+eater);
+                x1 = x+(pext?uiClampSize(pext, dim, size):size);
             }
             ix0 = (short)x;
             if (wrap)
@@ -1556,6 +3573,9 @@ UI_INLINE void uiArrangeImposedRange(UIcontext *ui_context, UIitem *pitem, int d
         } break;
         case UI_HFILL: {
             pkid->size[dim] = ui_max(0,space-pkid->margins[dim]-pkid->margins[wdim]);
+            UIitemExt *pext = uiLimitsPtr(ui_context, kid);
+            if (pext)
+                pkid->size[dim] = (short)uiClampSize(pext, dim, pkid->size[dim]);
         } break;
         }
         pkid->margins[dim] += offset;
@@ -1565,7 +3585,7 @@ UI_INLINE void uiArrangeImposedRange(UIcontext *ui_context, UIitem *pitem, int d
 }
 
 UI_INLINE void uiArrangeImposed(UIcontext *ui_context, UIitem *pitem, int dim) {
-    uiArrangeImposedRange(ui_context, pitem, dim, pitem->firstkid, -1, pitem->margins[dim], pitem->size[dim]);
+    uiArrangeImposedRange(ui_context, pitem, dim, uiSkipHidden(ui_context, pitem->firstkid), -1, pitem->margins[dim], pitem->size[dim]);
 }
 
 // superimpose all items according to their alignment,
@@ -1581,6 +3601,9 @@ UI_INLINE void uiArrangeImposedSqueezedRange(UIcontext *ui_context, UIitem *pite
         int flags = (pkid->flags & UI_ITEM_LAYOUT_MASK) >> dim;
 
         short min_size = ui_max(0,space-pkid->margins[dim]-pkid->margins[wdim]);
+        UIitemExt *pext = uiLimitsPtr(ui_context, kid);
+        if (pext)
+            min_size = (short)uiClampSize(pext, dim, min_size);
         switch(flags & UI_HFILL) {
         default: {
             pkid->size[dim] = ui_min(pkid->size[dim], min_size);
@@ -1604,7 +3627,7 @@ UI_INLINE void uiArrangeImposedSqueezedRange(UIcontext *ui_context, UIitem *pite
 }
 
 UI_INLINE void uiArrangeImposedSqueezed(UIcontext *ui_context, UIitem *pitem, int dim) {
-    uiArrangeImposedSqueezedRange(ui_context, pitem, dim, pitem->firstkid, -1, pitem->margins[dim], pitem->size[dim]);
+    uiArrangeImposedSqueezedRange(ui_context, pitem, dim, uiSkipHidden(ui_context, pitem->firstkid), -1, pitem->margins[dim], pitem->size[dim]);
 }
 
 // superimpose all items according to their alignment
@@ -1614,7 +3637,7 @@ UI_INLINE short uiArrangeWrappedImposedSqueezed(UIcontext *ui_context, UIitem *p
     short offset = pitem->margins[dim];
 
     short need_size = 0;
-    int kid = pitem->firstkid;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
     int start_kid = kid;
     while (kid >= 0) {
         UIitem *pkid = uiItemPtr(ui_context, kid);
@@ -1638,24 +3661,103 @@ UI_INLINE short uiArrangeWrappedImposedSqueezed(UIcontext *ui_context, UIitem *p
     return offset;
 }
 
-static void uiArrange(UIcontext *ui_context, int item, int dim) {
-    UIitem *pitem = uiItemPtr(ui_context, item);
+// place all items in their grid cells; tracks are sized once per grid and
+// distributed according to the justification flags
+static void uiArrangeGrid(UIcontext *ui_context, UIitem *pitem, int dim) {
+    short *tracks = ui_context->tracks;
+    int count = uiComputeGridTracks(ui_context, pitem, dim);
+    if (!count) return;
+    // track offsets are stored behind the track sizes
+    short *offsets = tracks + count;
 
-    switch(pitem->flags & UI_ITEM_BOX_MODEL_MASK) {
-    case UI_COLUMN|UI_WRAP: {
-        // flex model, wrapping
-        if (dim) { // direction
-            uiArrangeStacked(ui_context, pitem, 1, true);
-            // this retroactive resize will not effect parent widths
-            short offset = uiArrangeWrappedImposedSqueezed(ui_context, pitem, 0);
-            pitem->size[0] = offset - pitem->margins[0];
-        }
-    } break;
-    case UI_ROW|UI_WRAP: {
-        // flex model, wrapping
-        if (!dim) { // direction
-            uiArrangeStacked(ui_context, pitem, 0, true);
-        } else {
+    int i;
+    short used = 0;
+    for (i = 0; i < count; ++i) {
+        used += tracks[i];
+    }
+
+    int extra_space = pitem->size[dim] - used;
+    float filler = 0.0f;
+    float extra_margin = 0.0f;
+
+    if (extra_space > 0) {
+        switch(pitem->flags & UI_JUSTIFY) {
+        default: {
+            extra_margin = extra_space / 2.0f;
+        } break;
+        case UI_JUSTIFY: {
+            filler = (float)extra_space / (float)count;
+        } break;
+        case UI_START: {
+        } break;
+        case UI_END: {
+            extra_margin = extra_space;
+        } break;
+        }
+    }
+
+    // first pass: position and rescale tracks
+    float x = (float)pitem->margins[dim] + extra_margin;
+    for (i = 0; i < count; ++i) {
+        float x1 = x + (float)tracks[i] + filler;
+        offsets[i] = (short)x;
+        tracks[i] = (short)x1 - offsets[i];
+        x = x1;
+    }
+
+    // second pass: align items within their cells
+    int col = 0;
+    int row = 0;
+    int kid = uiSkipHidden(ui_context, pitem->firstkid);
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(ui_context, kid);
+        if (col && (pkid->flags & UI_BREAK)) {
+            row++;
+            col = 0;
+        }
+        int track = dim?row:col;
+        int nextkid = uiNextSibling(ui_context, kid);
+        uiArrangeImposedSqueezedRange(ui_context, pitem, dim, kid, nextkid,
+            offsets[track], tracks[track]);
+        col++;
+        kid = nextkid;
+    }
+}
+
+static void uiArrange(UIcontext *ui_context, int item, int dim) {
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    double start = uiBeginCost(ui_context);
+
+    // children of a scroll view are arranged within the content size
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    short size = pitem->size[dim];
+    if (pext && (pext->flags & UI_EXT_SCROLL)) {
+        pitem->size[dim] = ui_max(size, pext->content[dim]);
+    }
+
+    switch(pitem->flags & UI_ITEM_BOX_MODEL_MASK) {
+    case UI_COLUMN|UI_WRAP: {
+        // flex model, wrapping
+        if (dim) { // direction
+            uiArrangeStacked(ui_context, pitem, 1, true);
+            // this retroactive resize does not effect parent widths; grown
+            // columns are queued so uiEndLayout() can layout their parents
+            // again.
+            short offset = uiArrangeWrappedImposedSqueezed(ui_context, pitem, 0);
+            short size = offset - pitem->margins[0];
+            if ((size > pitem->size[0]) && !ui_context->relayouting) {
+                if (ui_context->relayoutcount < UI_MAX_RELAYOUT)
+                    ui_context->relayout[ui_context->relayoutcount] = item;
+                ui_context->relayoutcount++;
+            }
+            pitem->size[0] = size;
+        }
+    } break;
+    case UI_ROW|UI_WRAP: {
+        // flex model, wrapping
+        if (!dim) { // direction
+            uiArrangeStacked(ui_context, pitem, 0, true);
+        } else {
             uiArrangeWrappedImposedSqueezed(ui_context, pitem, 1);
         }
     } break;
@@ -1667,17 +3769,58 @@ static void uiArrange(UIcontext *ui_context, int item, int dim) {
         else
             uiArrangeImposedSqueezed(ui_context, pitem, dim);
     } break;
+    case UI_GRID: {
+        // grid model
+        uiArrangeGrid(ui_context, pitem, dim);
+    } break;
     default: {
         // layout model
         uiArrangeImposed(ui_context, pitem, dim);
     } break;
     }
 
+    if (pext && (pext->flags & UI_EXT_SCROLL)) {
+        pext->content[dim] = pitem->size[dim];
+        pitem->size[dim] = size;
+    }
+
     int kid = uiFirstChild(ui_context, item);
     while (kid >= 0) {
         uiArrange(ui_context, kid, dim);
         kid = uiNextSibling(ui_context, kid);
     }
+    uiEndCost(ui_context, item, UI_PHASE_ARRANGE, start);
+}
+
+// invoke the measure callbacks of all visible items within the subtree of
+// root to compute their heights from their layouted widths
+static void uiMeasureItems(UIcontext *ui_context, int root) {
+    int i;
+    for (i = 0; i < ui_context->extcount; ++i) {
+        UIitemExt *pext = ui_context->exts + i;
+        if (!(pext->flags & UI_EXT_MEASURE))
+            continue;
+        UIitem *pitem = uiItemPtr(ui_context, pext->item);
+        if (pitem->flags & UI_ITEM_VFIXED)
+            continue;
+        // the width of items in hidden subtrees is undefined
+        int parent = pext->item;
+        while ((parent >= 0)
+                && !(uiItemPtr(ui_context, parent)->flags & UI_ITEM_HIDDEN)) {
+            if (parent == root)
+                break;
+            parent = ui_context->parents[parent];
+        }
+        if (parent != root)
+            continue;
+        short width = pitem->size[0];
+        if (!(pext->flags & UI_EXT_MEASURED) || (pext->measured_width != width)) {
+            pext->measured_width = width;
+            pext->measured_height = (short)pext->measure(ui_context, pext->item, width);
+            pext->flags |= UI_EXT_MEASURED;
+        }
+        pitem->size[1] = pext->measured_height;
+    }
 }
 
 UI_INLINE bool uiCompareItems(UIcontext *ui_context, UIitem *item1, UIitem *item2) {
@@ -1721,6 +3864,123 @@ static bool uiMapItems(UIcontext *ui_context, int item1, int item2) {
     return true;
 }
 
+// layout item and all its children; unless item is the root, the
+// rectangle of item is kept as it has been arranged by its parent
+static void uiLayoutItem(UIcontext *ui_context, int item) {
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    short size[2] = { pitem->size[0], pitem->size[1] };
+    double start = uiBeginPhase(UI_PHASE_COMPUTE);
+    uiComputeSize(ui_context, item, 0);
+    if (item)
+        pitem->size[0] = size[0];
+    uiEndPhase(ui_context, UI_PHASE_COMPUTE, start);
+    start = uiBeginPhase(UI_PHASE_ARRANGE);
+    uiArrange(ui_context, item, 0);
+    uiEndPhase(ui_context, UI_PHASE_ARRANGE, start);
+    start = uiBeginPhase(UI_PHASE_COMPUTE);
+    uiMeasureItems(ui_context, item);
+    uiComputeSize(ui_context, item, 1);
+    if (item)
+        pitem->size[1] = size[1];
+    uiEndPhase(ui_context, UI_PHASE_COMPUTE, start);
+    start = uiBeginPhase(UI_PHASE_ARRANGE);
+    uiArrange(ui_context, item, 1);
+    uiEndPhase(ui_context, UI_PHASE_ARRANGE, start);
+}
+
+// returns the closest parent of item whose size does not depend on its
+// children, or the root
+static int uiGetLayoutBoundary(UIcontext *ui_context, int item) {
+    // the position of a window does not depend on its siblings
+    if (uiIsWindow(ui_context, item))
+        return item;
+    int parent = ui_context->parents[item];
+    while (parent > 0) {
+        UIitem *pparent = uiItemPtr(ui_context, parent);
+        if ((pparent->flags & UI_ITEM_FIXED_MASK) == UI_ITEM_FIXED_MASK)
+            return parent;
+        parent = ui_context->parents[parent];
+    }
+    return 0;
+}
+
+// restore the declared state of all children of item; if pin is set,
+// the listed wrapping columns keep their width so their parents can make
+// room for them
+static void uiRestoreItems(UIcontext *ui_context, int item,
+        const int *items, int count, bool pin) {
+    int kid = ui_context->source_items[item].firstkid;
+    while (kid >= 0) {
+        UIitem *pkid = uiItemPtr(ui_context, kid);
+        short size = pkid->size[0];
+        *pkid = ui_context->source_items[kid];
+        if (pin && ((pkid->flags & UI_ITEM_BOX_MODEL_MASK) == (UI_COLUMN|UI_WRAP))
+                && !(pkid->flags & UI_ITEM_HFIXED)
+                && uiInItemList(items, count, kid)) {
+            pkid->size[0] = size;
+        }
+        uiRestoreItems(ui_context, kid, items, count, pin);
+        kid = pkid->nextitem;
+    }
+}
+
+// layout the closest fixed size parents of the listed items again; if
+// count exceeds UI_MAX_RELAYOUT, the entire tree is layouted again
+static void uiRelayoutItems(UIcontext *ui_context,
+        const int *items, int count, bool pin) {
+    int boundaries[UI_MAX_RELAYOUT];
+    int boundarycount = 0;
+    int i;
+    if (count > UI_MAX_RELAYOUT) {
+        boundaries[boundarycount++] = 0;
+    } else {
+        for (i = 0; i < count; ++i) {
+            int boundary = uiGetLayoutBoundary(ui_context, items[i]);
+            if (!uiInItemList(boundaries, boundarycount, boundary))
+                boundaries[boundarycount++] = boundary;
+        }
+    }
+
+    for (i = 0; i < boundarycount; ++i) {
+        // skip subtrees that are contained in another listed subtree
+        int parent = ui_context->parents[boundaries[i]];
+        while ((parent >= 0)
+                && !uiInItemList(boundaries, boundarycount, parent)) {
+            parent = ui_context->parents[parent];
+        }
+        if (parent >= 0)
+            continue;
+
+        // children may have been inserted or removed; unless the boundary
+        // is the root or a window, it keeps the rectangle it has been
+        // arranged to by its parent
+        UIitem *pboundary = uiItemPtr(ui_context, boundaries[i]);
+        UIitem arranged = *pboundary;
+        *pboundary = ui_context->source_items[boundaries[i]];
+        if (boundaries[i] && !uiIsWindow(ui_context, boundaries[i])) {
+            pboundary->margins[0] = arranged.margins[0];
+            pboundary->margins[1] = arranged.margins[1];
+            pboundary->size[0] = arranged.size[0];
+            pboundary->size[1] = arranged.size[1];
+            pboundary->flags |= arranged.flags & UI_BREAK;
+        }
+        uiRestoreItems(ui_context, boundaries[i], items, count, pin);
+        uiLayoutItem(ui_context, boundaries[i]);
+    }
+}
+
+// layout the parents of wrapping columns that have grown while their
+// heights were arranged again, with the columns keeping their new width
+static void uiRelayoutGrownColumns(UIcontext *ui_context) {
+    if (!ui_context->relayoutcount)
+        return;
+    ui_context->relayouting = true;
+    uiRelayoutItems(ui_context, ui_context->relayout,
+        ui_context->relayoutcount, true);
+    ui_context->relayouting = false;
+    ui_context->relayoutcount = 0;
+}
+
 int uiRecoverItem(UIcontext *ui_context, int olditem) {
     assert(ui_context);
     assert((olditem >= -1) && (olditem < ui_context->last_count));
@@ -1738,29 +3998,163 @@ void uiRemapItem(UIcontext *ui_context, int olditem, int newitem) {
 void uiEndLayout(UIcontext *ui_context) {
     assert(ui_context);
     assert(ui_context->stage == UI_STAGE_LAYOUT); // must run uiBeginLayout() first
+#ifdef OUI_TRACE
+    uiTraceBeginItem("uiEndLayout", -1);
+#endif
 
     if (ui_context->count) {
-        uiComputeSize(ui_context, 0, 0);
-        uiArrange(ui_context, 0, 0);
-        uiComputeSize(ui_context, 0, 1);
-        uiArrange(ui_context, 0, 1);
+        // wrapping columns may require a second layout pass, and retained
+        // items are modified apart from their layouted state
+        if (ui_context->has_column_wraps || ui_context->retained) {
+            memcpy(ui_context->source_items, ui_context->items,
+                sizeof(UIitem) * ui_context->count);
+        }
+        ui_context->relayoutcount = 0;
+        ui_context->dirtycount = 0;
+#ifdef OUI_STATS
+        if (ui_context->inspect) {
+            memset(ui_context->costs, 0,
+                sizeof(float) * 2 * ui_context->count);
+        }
+#endif
+        uiLayoutItem(ui_context, 0);
+        uiRelayoutGrownColumns(ui_context);
+        uiUpdateMoved(ui_context);
 
         if (ui_context->last_count) {
             // map old item id to new item id
+            double start = uiBeginPhase(UI_PHASE_MAP);
             uiMapItems(ui_context, 0, 0);
+            uiEndPhase(ui_context, UI_PHASE_MAP, start);
         }
     }
+    if ((ui_context->count != ui_context->last_count)
+            || memcmp(ui_context->items, ui_context->last_items,
+                sizeof(UIitem) * ui_context->count)) {
+        ui_context->redraw = true;
+    }
 
     uiValidateStateItems(ui_context);
+    uiValidateTimers(ui_context);
+    if (ui_context->drag_type) {
+        ui_context->drag_source = uiRecoverItem(ui_context, ui_context->drag_source);
+        ui_context->drag_target = uiRecoverItem(ui_context, ui_context->drag_target);
+        uiBuildDropTargets(ui_context);
+    }
     if (ui_context->count) {
         // drawing routines may require this to be set already
         uiUpdateHotItem(ui_context);
     }
 
     ui_context->stage = UI_STAGE_POST_LAYOUT;
+#ifdef OUI_TRACE
+    uiTraceEnd();
+#endif
 }
 
-UIrect uiGetRect(UIcontext *ui_context, int item) {
+void uiRelayout(UIcontext *ui_context) {
+    assert(ui_context);
+    assert(ui_context->retained);
+    assert(ui_context->stage != UI_STAGE_LAYOUT); // must run uiEndLayout() first
+    if (!ui_context->dirtycount)
+        return;
+    ui_context->relayoutcount = 0;
+    uiRelayoutItems(ui_context, ui_context->dirty,
+        ui_context->dirtycount, false);
+    ui_context->dirtycount = 0;
+    uiRelayoutGrownColumns(ui_context);
+    uiBuildDropTargets(ui_context);
+    uiUpdateHotItem(ui_context);
+    ui_context->redraw = true;
+}
+
+typedef struct UIbatch {
+    UIcontext **contexts;
+    int count;
+    // index of the next context to layout
+    volatile long next;
+} UIbatch;
+
+// layout contexts of the batch until none are left
+static void uiRunBatch(UIbatch *batch) {
+    while (true) {
+#if defined(OUI_THREADS) && defined(_WIN32)
+        long i = InterlockedIncrement(&batch->next) - 1;
+#elif defined(OUI_THREADS)
+        long i = __sync_fetch_and_add(&batch->next, 1);
+#else
+        long i = batch->next++;
+#endif
+        if (i >= batch->count)
+            break;
+        uiEndLayout(batch->contexts[i]);
+    }
+}
+
+#ifdef OUI_THREADS
+#ifdef _WIN32
+static DWORD WINAPI uiBatchThread(LPVOID batch) {
+    uiRunBatch((UIbatch *)batch);
+#ifdef OUI_TRACE
+    uiReleaseTraceRing();
+#endif
+    return 0;
+}
+#else
+static void *uiBatchThread(void *batch) {
+    uiRunBatch((UIbatch *)batch);
+#ifdef OUI_TRACE
+    uiReleaseTraceRing();
+#endif
+    return NULL;
+}
+#endif
+#endif
+
+void uiEndLayoutBatch(UIcontext **contexts, int count, int threads) {
+    assert(contexts && (count >= 0));
+    UIbatch batch;
+    batch.contexts = contexts;
+    batch.count = count;
+    batch.next = 0;
+#ifdef OUI_THREADS
+    // the calling thread takes part, and a failure to start a thread only
+    // reduces parallelism
+    int i;
+    int started = 0;
+    threads = ui_min(ui_min(threads, count), UI_MAX_BATCH_THREADS) - 1;
+#ifdef _WIN32
+    HANDLE workers[UI_MAX_BATCH_THREADS];
+    for (i = 0; i < threads; ++i) {
+        workers[started] = CreateThread(NULL, 0, uiBatchThread, &batch, 0, NULL);
+        if (workers[started])
+            started++;
+    }
+    uiRunBatch(&batch);
+    for (i = 0; i < started; ++i) {
+        WaitForSingleObject(workers[i], INFINITE);
+        CloseHandle(workers[i]);
+    }
+#else
+    pthread_t workers[UI_MAX_BATCH_THREADS];
+    for (i = 0; i < threads; ++i) {
+        if (!pthread_create(&workers[started], NULL, uiBatchThread, &batch))
+            started++;
+    }
+    uiRunBatch(&batch);
+    for (i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+#endif
+#else
+    (void)threads;
+    uiRunBatch(&batch);
+#endif
+}
+
+// returns the rectangle of an item as computed by uiEndLayout(), without
+// scroll offsets and transforms applied
+UI_INLINE UIrect uiGetLayoutRect(UIcontext *ui_context, int item) {
     UIitem *pitem = uiItemPtr(ui_context, item);
     UIrect rc = {{{
             pitem->margins[0], pitem->margins[1],
@@ -1769,33 +4163,230 @@ UIrect uiGetRect(UIcontext *ui_context, int item) {
     return rc;
 }
 
+// maps the point (x,y) from layout coordinates of item to the coordinate
+// space of its parent by applying the items transform
+UI_INLINE void uiApplyTransform(UIcontext *ui_context, int item, UIitemExt *pext,
+        float *x, float *y) {
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    *x = (float)pitem->margins[0] + pext->offset[0]
+        + (*x - (float)pitem->margins[0]) * pext->scale;
+    *y = (float)pitem->margins[1] + pext->offset[1]
+        + (*y - (float)pitem->margins[1]) * pext->scale;
+}
+
+// maps the point (x,y) from the coordinate space of the parent of item to
+// layout coordinates of item; returns false if the item has a scale of 0
+UI_INLINE bool uiRevertTransform(UIcontext *ui_context, int item, UIitemExt *pext,
+        float *x, float *y) {
+    if (pext->scale == 0.0f)
+        return false;
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    *x = (float)pitem->margins[0]
+        + (*x - (float)pitem->margins[0] - pext->offset[0]) / pext->scale;
+    *y = (float)pitem->margins[1]
+        + (*y - (float)pitem->margins[1] - pext->offset[1]) / pext->scale;
+    return true;
+}
+
+// maps the absolute point (x,y) to the layout coordinates of the children
+// of item, reverting all scroll offsets and transforms from the root down
+static void uiGetChildPoint(UIcontext *ui_context, int item, float *x, float *y) {
+    if ((item < 0) || !ui_context->moved[item])
+        return;
+    uiGetChildPoint(ui_context, ui_context->parents[item], x, y);
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    if (!pext)
+        return;
+    if (pext->flags & UI_EXT_TRANSFORM)
+        uiRevertTransform(ui_context, item, pext, x, y);
+    if (pext->flags & UI_EXT_SCROLL) {
+        *x += (float)pext->scroll[0];
+        *y += (float)pext->scroll[1];
+    }
+}
+
+UIrect uiGetRect(UIcontext *ui_context, int item) {
+    UIrect rc = uiGetLayoutRect(ui_context, item);
+    if (!ui_context->moved[item])
+        return rc;
+    float x0 = (float)rc.x;
+    float y0 = (float)rc.y;
+    float x1 = (float)(rc.x + rc.w);
+    float y1 = (float)(rc.y + rc.h);
+    // apply the transform of the item and the scroll offsets and transforms
+    // of all its parents; the parents of the topmost moved item are unmoved
+    int node = item;
+    while ((node >= 0) && ui_context->moved[node]) {
+        UIitemExt *pext = uiExtPtr(ui_context, node);
+        if (pext) {
+            if ((node != item) && (pext->flags & UI_EXT_SCROLL)) {
+                x0 -= (float)pext->scroll[0];
+                y0 -= (float)pext->scroll[1];
+                x1 -= (float)pext->scroll[0];
+                y1 -= (float)pext->scroll[1];
+            }
+            if (pext->flags & UI_EXT_TRANSFORM) {
+                uiApplyTransform(ui_context, node, pext, &x0, &y0);
+                uiApplyTransform(ui_context, node, pext, &x1, &y1);
+            }
+        }
+        node = ui_context->parents[node];
+    }
+    rc.x = ui_round(x0);
+    rc.y = ui_round(y0);
+    rc.w = ui_round(x1) - rc.x;
+    rc.h = ui_round(y1) - rc.y;
+    return rc;
+}
+
+void uiSetInspect(UIcontext *ui_context, bool enable) {
+    assert(ui_context);
+#ifdef OUI_STATS
+    ui_context->inspect = enable;
+#else
+    (void)enable;
+#endif
+}
+
+// write the visible items in the subtree of item, children first; returns
+// the number of items written
+static int uiDumpItem(UIcontext *ui_context, int item, int parent,
+        UIwriter write, void *user, bool *first) {
+    char buffer[256];
+    int count = 1;
+    int kid = uiFirstChild(ui_context, item);
+    while (kid >= 0) {
+        count += uiDumpItem(ui_context, kid, item, write, user, first);
+        kid = uiNextSibling(ui_context, kid);
+    }
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    UIrect rc = uiGetLayoutRect(ui_context, item);
+    float costs[2] = { 0.0f, 0.0f };
+#ifdef OUI_STATS
+    costs[0] = ui_context->costs[item * 2 + UI_PHASE_COMPUTE];
+    costs[1] = ui_context->costs[item * 2 + UI_PHASE_ARRANGE];
+#endif
+    int len = sprintf(buffer, "%s{\"item\":%d,\"parent\":%d,\"box\":%u,"
+        "\"layout\":%u,\"rect\":[%d,%d,%d,%d],\"count\":%d,"
+        "\"compute\":%.6f,\"arrange\":%.6f}",
+        *first?"":",", item, parent,
+        pitem->flags & UI_ITEM_BOX_MASK, pitem->flags & UI_ITEM_LAYOUT_MASK,
+        rc.x, rc.y, rc.w, rc.h, count, (double)costs[0], (double)costs[1]);
+    write(user, buffer, (unsigned int)len);
+    *first = false;
+    return count;
+}
+
+void uiDumpLayout(UIcontext *ui_context, int item,
+        UIwriter write, void *user) {
+    assert(ui_context && write);
+    assert(ui_context->stage != UI_STAGE_LAYOUT); // must run uiEndLayout() first
+    assert((item >= 0) && (item < ui_context->count));
+    bool first = true;
+    write(user, "[", 1);
+    uiDumpItem(ui_context, item, ui_context->parents[item], write, user, &first);
+    write(user, "]\n", 2);
+}
+
+float uiGetScale(UIcontext *ui_context, int item) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    float scale = 1.0f;
+    while ((item >= 0) && ui_context->moved[item]) {
+        UIitemExt *pext = uiExtPtr(ui_context, item);
+        if (pext && (pext->flags & UI_EXT_TRANSFORM))
+            scale *= pext->scale;
+        item = ui_context->parents[item];
+    }
+    return scale;
+}
+
 int uiFirstChild(UIcontext *ui_context, int item) {
-    return uiItemPtr(ui_context, item)->firstkid;
+    return uiSkipHidden(ui_context, uiItemPtr(ui_context, item)->firstkid);
 }
 
 int uiNextSibling(UIcontext *ui_context, int item) {
-    return uiItemPtr(ui_context, item)->nextitem;
+    return uiSkipHidden(ui_context, uiItemPtr(ui_context, item)->nextitem);
 }
 
-void *uiAllocHandle(UIcontext *ui_context, int item, unsigned int size) {
-    assert((size > 0) && (size < UI_MAX_DATASIZE));
+// relocate the data buffer to a larger buffer of at least size bytes;
+// returns false if the buffer can not grow
+static bool uiGrowData(UIcontext *ui_context, unsigned int size) {
+    // contexts created in place can not allocate memory
+    if (!ui_context->allocator.alloc)
+        return false;
+    unsigned int limit = UINT_MAX - (UI_MAX_HANDLE_ALIGNMENT - 1);
+    if (size > limit)
+        return false;
+    unsigned int capacity = (ui_context->buffer_capacity > limit / 2)?
+        limit:(ui_context->buffer_capacity * 2);
+    if (capacity < size)
+        capacity = size;
+    void *block = ui_context->allocator.alloc(ui_context->allocator.user,
+        capacity + UI_MAX_HANDLE_ALIGNMENT - 1);
+    if (!block)
+        return false;
+    unsigned char *data = uiAlignPointer((unsigned char *)block);
+    if (ui_context->datasize)
+        memcpy(data, ui_context->data, ui_context->datasize);
+    if (ui_context->data_block)
+        ui_context->allocator.free(ui_context->allocator.user, ui_context->data_block);
+    ui_context->data_block = block;
+    ui_context->data = data;
+    ui_context->buffer_capacity = capacity;
+    return true;
+}
+
+void *uiAllocHandleAligned(UIcontext *ui_context, int item,
+        unsigned int size, unsigned int alignment) {
+    assert(size > 0);
+    assert(alignment && !(alignment & (alignment - 1))
+        && (alignment <= UI_MAX_HANDLE_ALIGNMENT));
     UIitem *pitem = uiItemPtr(ui_context, item);
-    assert(pitem->handle == NULL);
-    assert((ui_context->datasize+size) <= ui_context->buffer_capacity);
-    pitem->handle = ui_context->data + ui_context->datasize;
+    assert(uiGetHandle(ui_context, item) == NULL);
+    unsigned int offset = (ui_context->datasize + alignment - 1) & ~(alignment - 1);
+    if (size > UINT_MAX - offset)
+        return NULL;
+    if (((offset + size) > ui_context->buffer_capacity)
+            && !uiGrowData(ui_context, offset + size))
+        return NULL;
+    pitem->offset = offset;
     pitem->flags |= UI_ITEM_DATA;
-    ui_context->datasize += size;
-    return pitem->handle;
+    ui_context->datasize = offset + size;
+    if (ui_context->retained && (ui_context->stage != UI_STAGE_LAYOUT))
+        ui_context->source_items[item].offset = offset;
+    uiSyncFlags(ui_context, item, UI_ITEM_DATA);
+    return ui_context->data + offset;
+}
+
+void *uiAllocHandle(UIcontext *ui_context, int item, unsigned int size) {
+    return uiAllocHandleAligned(ui_context, item, size, UI_HANDLE_ALIGNMENT);
 }
 
 void uiSetHandle(UIcontext *ui_context, int item, void *handle) {
+    assert(uiGetHandle(ui_context, item) == NULL);
+#ifdef OUI_COMPACT_ITEMS
+    // compact items can only refer to the data buffer
+    UIitemExt *pext = uiAllocExt(ui_context, item);
+    pext->flags |= UI_EXT_HANDLE;
+    pext->handle = handle;
+#else
     UIitem *pitem = uiItemPtr(ui_context, item);
-    assert(pitem->handle == NULL);
     pitem->handle = handle;
+    if (ui_context->retained && (ui_context->stage != UI_STAGE_LAYOUT))
+        ui_context->source_items[item].handle = handle;
+#endif
 }
 
 void *uiGetHandle(UIcontext *ui_context, int item) {
-    return uiItemPtr(ui_context, item)->handle;
+    UIitem *pitem = uiItemPtr(ui_context, item);
+    if (pitem->flags & UI_ITEM_DATA)
+        return ui_context->data + pitem->offset;
+#ifdef OUI_COMPACT_ITEMS
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    return (pext && (pext->flags & UI_EXT_HANDLE))?pext->handle:NULL;
+#else
+    return pitem->handle;
+#endif
 }
 
 void uiSetHandler(UIcontext *ui_context, UIhandler handler) {
@@ -1808,10 +4399,24 @@ UIhandler uiGetHandler(UIcontext *ui_context) {
     return ui_context->handler;
 }
 
+void uiSetEventQueue(UIcontext *ui_context, bool enable) {
+    assert(ui_context);
+    ui_context->queue_events = enable;
+    ui_context->queuecount = 0;
+    ui_context->queuebatch = 0;
+}
+
+const UIeventRecord *uiGetEventQueue(UIcontext *ui_context, int *count) {
+    assert(ui_context && count);
+    *count = ui_context->queuebatch;
+    return ui_context->queue;
+}
+
 void uiSetEvents(UIcontext *ui_context, int item, unsigned int flags) {
     UIitem *pitem = uiItemPtr(ui_context, item);
     pitem->flags &= ~UI_ITEM_EVENT_MASK;
     pitem->flags |= flags & UI_ITEM_EVENT_MASK;
+    uiSyncFlags(ui_context, item, UI_ITEM_EVENT_MASK);
 }
 
 unsigned int uiGetEvents(UIcontext *ui_context, int item) {
@@ -1822,6 +4427,7 @@ void uiSetFlags(UIcontext *ui_context, int item, unsigned int flags) {
     UIitem *pitem = uiItemPtr(ui_context, item);
     pitem->flags &= ~UI_USERMASK;
     pitem->flags |= flags & UI_USERMASK;
+    uiSyncFlags(ui_context, item, UI_USERMASK);
 }
 
 unsigned int uiGetFlags(UIcontext *ui_context, int item) {
@@ -1839,16 +4445,34 @@ int uiContains(UIcontext *ui_context, int item, int x, int y) {
     return 0;
 }
 
-int uiFindItem(UIcontext *ui_context, int item, int x, int y, unsigned int flags, unsigned int mask) {
+// same as uiFindItem(), but x and y are in the coordinate space of the
+// parents children
+static int uiFindItemLocal(UIcontext *ui_context, int item, float x, float y,
+        unsigned int flags, unsigned int mask) {
     UIitem *pitem = uiItemPtr(ui_context, item);
-    if (pitem->flags & UI_ITEM_FROZEN) return -1;
-    if (uiContains(ui_context, item, x, y)) {
+    if (pitem->flags & (UI_ITEM_FROZEN|UI_ITEM_HIDDEN)) return -1;
+    UIitemExt *pext = uiExtPtr(ui_context, item);
+    if (pext && (pext->flags & UI_EXT_TRANSFORM)) {
+        if (!uiRevertTransform(ui_context, item, pext, &x, &y))
+            return -1;
+    }
+    if ((x >= (float)pitem->margins[0])
+            && (y >= (float)pitem->margins[1])
+            && (x < (float)(pitem->margins[0] + pitem->size[0]))
+            && (y < (float)(pitem->margins[1] + pitem->size[1]))) {
+        if (pext && (pext->flags & UI_EXT_SCROLL)) {
+            x += (float)pext->scroll[0];
+            y += (float)pext->scroll[1];
+        }
         int best_hit = -1;
         int kid = uiFirstChild(ui_context, item);
         while (kid >= 0) {
-            int hit = uiFindItem(ui_context, kid, x, y, flags, mask);
-            if (hit >= 0) {
-                best_hit = hit;
+            // layers are searched by uiFindTopItem()
+            if (!ui_context->layercount || !uiIsLayer(ui_context, kid)) {
+                int hit = uiFindItemLocal(ui_context, kid, x, y, flags, mask);
+                if (hit >= 0) {
+                    best_hit = hit;
+                }
             }
             kid = uiNextSibling(ui_context, kid);
         }
@@ -1864,60 +4488,176 @@ int uiFindItem(UIcontext *ui_context, int item, int x, int y, unsigned int flags
     return -1;
 }
 
+int uiFindItem(UIcontext *ui_context, int item, int x, int y, unsigned int flags, unsigned int mask) {
+#ifdef OUI_STATS
+    ui_context->stats.hit_tests++;
+#endif
+    float fx = (float)x;
+    float fy = (float)y;
+    uiGetChildPoint(ui_context, ui_context->parents[item], &fx, &fy);
+    return uiFindItemLocal(ui_context, item, fx, fy, flags, mask);
+}
+
+int uiFindTopItem(UIcontext *ui_context, int x, int y,
+        unsigned int flags, unsigned int mask) {
+    assert(ui_context);
+    if (ui_context->input_window < 0)
+        return -1;
+    int i;
+    for (i = ui_context->layercount - 1; i >= 0; --i) {
+        int layer = ui_context->layers[i];
+        if (!uiIsReachable(ui_context, layer)
+                || !uiInInputWindow(ui_context, layer))
+            continue;
+        int hit = uiFindItem(ui_context, layer, x, y, flags, mask);
+        if (hit >= 0)
+            return hit;
+        if ((uiExtPtr(ui_context, layer)->flags & UI_EXT_OPAQUE)
+                && uiContains(ui_context, layer, x, y))
+            return -1;
+    }
+    return uiFindItem(ui_context, ui_context->input_window, x, y, flags, mask);
+}
+
 void uiUpdateHotItem(UIcontext *ui_context) {
     assert(ui_context);
     if (!ui_context->count) return;
-    ui_context->hot_item = uiFindItem(ui_context, 0,
+    double start = uiBeginPhase(UI_PHASE_HIT_TEST);
+    ui_context->hot_item = uiFindTopItem(ui_context,
             ui_context->cursor.x, ui_context->cursor.y,
             UI_ANY_MOUSE_INPUT, UI_ANY);
+    uiEndPhase(ui_context, UI_PHASE_HIT_TEST, start);
 }
 
-int uiGetClicks(UIcontext *ui_context) {
-    return ui_context->clicks;
+void uiBeginDrag(UIcontext *ui_context, int item, unsigned int type) {
+    assert(ui_context && (item >= 0) && (item < ui_context->count));
+    assert(ui_context->stage != UI_STAGE_LAYOUT);
+    assert(type && ((type & UI_USERMASK) == type));
+    uiCancelDrag(ui_context);
+    ui_context->drag_type = type;
+    ui_context->drag_source = item;
+    ui_context->drag_target = -1;
+    uiBuildDropTargets(ui_context);
+    ui_context->redraw = true;
 }
 
-void uiProcess(UIcontext *ui_context, int timestamp) {
+void uiCancelDrag(UIcontext *ui_context) {
     assert(ui_context);
+    if (!ui_context->drag_type)
+        return;
+    int target = ui_context->drag_target;
+    ui_context->drag_type = 0;
+    ui_context->drag_source = -1;
+    ui_context->drag_target = -1;
+    ui_context->drag_targetcount = 0;
+    ui_context->redraw = true;
+    if (target >= 0)
+        uiSendEvent(ui_context, target, UI_DRAG_LEAVE);
+}
 
-    assert(ui_context->stage != UI_STAGE_LAYOUT); // must run uiBeginLayout(), uiEndLayout() first
+unsigned int uiGetDragType(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->drag_type;
+}
 
-    if (ui_context->stage == UI_STAGE_PROCESS) {
-        uiUpdateHotItem(ui_context);
-    }
-    ui_context->stage = UI_STAGE_PROCESS;
+int uiGetDragSource(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->drag_source;
+}
 
-    if (!ui_context->count) {
-        uiClearInputEvents(ui_context);
-        return;
-    }
+int uiGetDropTarget(UIcontext *ui_context) {
+    assert(ui_context);
+    return ui_context->drag_target;
+}
 
-    int hot_item = ui_context->last_hot_item;
-    int active_item = ui_context->active_item;
-    int focus_item = ui_context->focus_item;
+// returns 1 if item and all its parents up to the root of its search in
+// uiFindTopItem() contain (x,y), so that items outside of scroll views
+// and other parents can not be hit
+static int uiContainsClipped(UIcontext *ui_context, int item, int x, int y) {
+    while (true) {
+        if (!uiContains(ui_context, item, x, y))
+            return 0;
+        if ((item <= 0) || (item == ui_context->input_window)
+                || uiIsLayer(ui_context, item))
+            return 1;
+        item = ui_context->parents[item];
+    }
+}
 
-    // send all keyboard events
-    if (focus_item >= 0) {
-        int i;
-        for (i = 0; i < ui_context->eventcount; ++i) {
-            ui_context->active_key = ui_context->events[i].key;
-            ui_context->active_modifier = ui_context->events[i].mod;
-            uiNotifyItem(ui_context, focus_item, ui_context->events[i].event);
-        }
-    } else {
-        ui_context->focus_item = -1;
+// returns the topmost drop target of the current drag at (x,y), or -1;
+// only the targets collected by uiBuildDropTargets() are tested
+static int uiFindDropTarget(UIcontext *ui_context, int x, int y) {
+    int i;
+    int first = 0;
+    if (ui_context->drag_targetcount > UI_MAX_DROP_TARGETS) {
+        return uiFindTopItem(ui_context, x, y,
+            ui_context->drag_type, UI_ANY);
     }
-    if (ui_context->scroll.x || ui_context->scroll.y) {
-        int scroll_item = uiFindItem(ui_context, 0,
-                ui_context->cursor.x, ui_context->cursor.y,
-                UI_SCROLL, UI_ANY);
-        if (scroll_item >= 0) {
-            uiNotifyItem(ui_context, scroll_item, UI_SCROLL);
+    // targets below an opaque layer can not be reached
+    for (i = ui_context->layercount - 1; i >= 0; --i) {
+        int layer = ui_context->layers[i];
+        if ((uiExtPtr(ui_context, layer)->flags & UI_EXT_OPAQUE)
+                && uiIsReachable(ui_context, layer)
+                && uiInInputWindow(ui_context, layer)
+                && uiContains(ui_context, layer, x, y)) {
+            first = ui_context->drag_layerstart[i];
+            break;
         }
     }
+    for (i = ui_context->drag_targetcount - 1; i >= first; --i) {
+        if (uiContainsClipped(ui_context, ui_context->drag_targets[i], x, y))
+            return ui_context->drag_targets[i];
+    }
+    return -1;
+}
 
-    uiClearInputEvents(ui_context);
+// send the drag events for the cursor position and button states of the
+// context
+static void uiProcessDrag(UIcontext *ui_context) {
+    if (!ui_context->drag_type)
+        return;
+    UIvec2 cursor = ui_context->cursor;
+    int target = uiFindDropTarget(ui_context, cursor.x, cursor.y);
+    if (target != ui_context->drag_target) {
+        int last_target = ui_context->drag_target;
+        ui_context->drag_target = target;
+        ui_context->drag_cursor = cursor;
+        if (last_target >= 0)
+            uiSendEvent(ui_context, last_target, UI_DRAG_LEAVE);
+        // the handler may have ended the drag
+        if ((target >= 0) && (ui_context->drag_target == target))
+            uiSendEvent(ui_context, target, UI_DRAG_ENTER);
+    } else if ((target >= 0)
+            && ((cursor.x != ui_context->drag_cursor.x)
+                || (cursor.y != ui_context->drag_cursor.y))) {
+        ui_context->drag_cursor = cursor;
+        uiSendEvent(ui_context, target, UI_DRAG_OVER);
+    }
+    if (ui_context->drag_type && !uiGetButton(ui_context, 0)) {
+        target = ui_context->drag_target;
+        ui_context->drag_type = 0;
+        ui_context->drag_source = -1;
+        ui_context->drag_target = -1;
+        ui_context->drag_targetcount = 0;
+        ui_context->redraw = true;
+        if (target >= 0)
+            uiSendEvent(ui_context, target, UI_DROP);
+    }
+}
+
+int uiGetClicks(UIcontext *ui_context) {
+    return ui_context->clicks;
+}
+
+// update the states for the cursor position and button states of the
+// context, where hot is the item under the cursor
+static void uiProcessButtons(UIcontext *ui_context, int hot, int timestamp) {
+    // targets receive UI_DROP before the source receives UI_BUTTON0_UP
+    uiProcessDrag(ui_context);
 
-    int hot = ui_context->hot_item;
+    int hot_item = ui_context->last_hot_item;
+    int active_item = ui_context->active_item;
+    int focus_item = ui_context->focus_item;
 
     switch(ui_context->state) {
     default:
@@ -1931,6 +4671,8 @@ void uiProcess(UIcontext *ui_context, int timestamp) {
                 focus_item = -1;
                 ui_context->focus_item = -1;
             }
+            uiRecordLatency(ui_context, UI_BUTTON0_DOWN, active_item,
+                ui_context->button_time);
 
             if (active_item >= 0) {
                 if (
@@ -1948,18 +4690,24 @@ void uiProcess(UIcontext *ui_context, int timestamp) {
             ui_context->state = UI_STATE_CAPTURE;
         } else if (uiGetButton(ui_context, 2) && !uiGetLastButton(ui_context, 2)) {
             hot_item = -1;
-            hot = uiFindItem(ui_context, 0, ui_context->cursor.x, ui_context->cursor.y,
+            hot = uiFindTopItem(ui_context, ui_context->cursor.x, ui_context->cursor.y,
                     UI_BUTTON2_DOWN, UI_ANY);
+            uiRecordLatency(ui_context, UI_BUTTON2_DOWN, hot,
+                ui_context->button_time);
             if (hot >= 0) {
                 ui_context->active_modifier = ui_context->active_button_modifier;
                 uiNotifyItem(ui_context, hot, UI_BUTTON2_DOWN);
             }
         } else {
             hot_item = hot;
+            uiRecordLatency(ui_context, (UIevent)0, hot,
+                ui_context->cursor_time);
         }
     } break;
     case UI_STATE_CAPTURE: {
         if (!uiGetButton(ui_context, 0)) {
+            uiRecordLatency(ui_context, UI_BUTTON0_UP, active_item,
+                ui_context->button_time);
             if (active_item >= 0) {
                 ui_context->active_modifier = ui_context->active_button_modifier;
                 uiNotifyItem(ui_context, active_item, UI_BUTTON0_UP);
@@ -1970,6 +4718,8 @@ void uiProcess(UIcontext *ui_context, int timestamp) {
             active_item = -1;
             ui_context->state = UI_STATE_IDLE;
         } else {
+            uiRecordLatency(ui_context, UI_BUTTON0_CAPTURE, active_item,
+                ui_context->cursor_time);
             if (active_item >= 0) {
                 ui_context->active_modifier = ui_context->active_button_modifier;
                 uiNotifyItem(ui_context, active_item, UI_BUTTON0_CAPTURE);
@@ -1986,10 +4736,140 @@ void uiProcess(UIcontext *ui_context, int timestamp) {
     ui_context->last_hot_item = hot_item;
     ui_context->active_item = active_item;
 
-    ui_context->last_timestamp = timestamp;
     ui_context->last_buttons = ui_context->buttons;
 }
 
+static void uiProcessInput(UIcontext *ui_context, int timestamp) {
+    assert(ui_context);
+
+    assert(ui_context->stage != UI_STAGE_LAYOUT); // must run uiBeginLayout(), uiEndLayout() first
+
+    if (ui_context->stage == UI_STAGE_PROCESS) {
+        uiUpdateHotItem(ui_context);
+    }
+    ui_context->stage = UI_STAGE_PROCESS;
+    ui_context->last_timestamp = timestamp;
+    // events sent since the last call, e.g. by uiCancelDrag(), lead the
+    // events of this call
+    ui_context->queuecount -= ui_context->queuebatch;
+    memmove(ui_context->queue, ui_context->queue + ui_context->queuebatch,
+        sizeof(UIeventRecord) * ui_context->queuecount);
+    ui_context->queuebatch = 0;
+    // the samples of this call stay available along with the queued events
+    memcpy(ui_context->last_samples, ui_context->samples,
+        sizeof(UIcursorSample) * ui_context->samplecount);
+    ui_context->last_samplecount = ui_context->samplecount;
+    ui_context->samplecount = 0;
+#ifdef OUI_STATS
+    ui_context->latencycount = 0;
+#endif
+
+    if (!ui_context->count) {
+        uiClearInputEvents(ui_context);
+        ui_context->stepcount = 0;
+        ui_context->cursor_time = ui_context->button_time = 0.0;
+        return;
+    }
+
+    int focus_item = ui_context->focus_item;
+
+    // send all keyboard events
+    if (focus_item >= 0) {
+        int i;
+        for (i = 0; i < ui_context->eventcount; ++i) {
+            ui_context->active_key = ui_context->events[i].key;
+            ui_context->active_modifier = ui_context->events[i].mod;
+            uiRecordLatency(ui_context, ui_context->events[i].event,
+                focus_item, ui_context->events[i].time);
+            uiNotifyItem(ui_context, focus_item, ui_context->events[i].event);
+        }
+    } else {
+        int i;
+        for (i = 0; i < ui_context->eventcount; ++i) {
+            uiRecordLatency(ui_context, ui_context->events[i].event,
+                -1, ui_context->events[i].time);
+        }
+        ui_context->focus_item = -1;
+    }
+    if (ui_context->scroll.x || ui_context->scroll.y) {
+        int scroll_item = uiFindTopItem(ui_context,
+                ui_context->cursor.x, ui_context->cursor.y,
+                UI_SCROLL, UI_ANY);
+        uiRecordLatency(ui_context, UI_SCROLL, scroll_item,
+            ui_context->scroll_time);
+        if (scroll_item >= 0) {
+            uiNotifyItem(ui_context, scroll_item, UI_SCROLL);
+        }
+    }
+
+    uiClearInputEvents(ui_context);
+
+    // replay the button changes since the last call in order, each at the
+    // cursor position where it happened
+    UIvec2 cursor = ui_context->cursor;
+    unsigned long long buttons = ui_context->buttons;
+    unsigned int mod = ui_context->active_button_modifier;
+    double cursor_time = ui_context->cursor_time;
+    ui_context->cursor_time = 0.0;
+    int i;
+    for (i = 0; i < ui_context->stepcount; ++i) {
+        UIbuttonStep *step = &ui_context->steps[i];
+        ui_context->cursor = step->cursor;
+        ui_context->buttons = step->buttons;
+        ui_context->active_button_modifier = step->mod;
+        ui_context->button_time = step->time;
+        int hot = uiFindTopItem(ui_context, step->cursor.x, step->cursor.y,
+            UI_ANY_MOUSE_INPUT, UI_ANY);
+        uiProcessButtons(ui_context, hot,
+            (step->timed)?step->timestamp:timestamp);
+    }
+    ui_context->cursor = cursor;
+    ui_context->buttons = buttons;
+    ui_context->active_button_modifier = mod;
+    ui_context->cursor_time = cursor_time;
+    // the last change already reflects the current states, unless the
+    // cursor has moved since
+    if (!ui_context->stepcount
+            || (ui_context->last_cursor.x != cursor.x)
+            || (ui_context->last_cursor.y != cursor.y)) {
+        if (ui_context->stepcount)
+            ui_context->button_time = 0.0;
+        uiProcessButtons(ui_context, ui_context->hot_item, timestamp);
+    }
+    ui_context->stepcount = 0;
+
+    uiProcessTimers(ui_context, timestamp);
+    ui_context->cursor_time = ui_context->button_time = 0.0;
+}
+
+void uiProcess(UIcontext *ui_context, int timestamp) {
+    double start = uiBeginPhase(UI_PHASE_PROCESS);
+    int hot_item = ui_context->last_hot_item;
+    int active_item = ui_context->active_item;
+    int focus_item = ui_context->focus_item;
+    uiProcessInput(ui_context, timestamp);
+    ui_context->queuebatch = ui_context->queuecount;
+    if ((hot_item != ui_context->last_hot_item)
+            || (active_item != ui_context->active_item)
+            || (focus_item != ui_context->focus_item)) {
+        ui_context->redraw = true;
+    }
+    uiEndPhase(ui_context, UI_PHASE_PROCESS, start);
+    uiCommitStats(ui_context);
+}
+
+int uiPollRedraw(UIcontext *ui_context) {
+    assert(ui_context);
+    int redraw = ui_context->redraw?1:0;
+    ui_context->redraw = false;
+    return redraw;
+}
+
+void uiRequestRedraw(UIcontext *ui_context) {
+    assert(ui_context);
+    ui_context->redraw = true;
+}
+
 static int uiIsActive(UIcontext *ui_context, int item) {
     assert(ui_context);
     return ui_context->active_item == item;
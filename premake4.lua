@@ -34,3 +34,20 @@ solution "blendish"
 			defines { "NDEBUG" }
 			flags { "Optimize", "ExtraWarnings", "FatalWarnings" }
 
+
+	project "test_retained"
+		kind "ConsoleApp"
+		language "C"
+		files { "test_retained.c" }
+		targetdir("build")
+
+		configuration { "linux" }
+			 links { "m" }
+
+		configuration "Debug"
+			defines { "DEBUG" }
+			flags { "Symbols" }
+
+		configuration "Release"
+			defines { "NDEBUG" }
+			flags { "Optimize" }
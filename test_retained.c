@@ -0,0 +1,99 @@
+// tests for modifying a retained tree after uiEndLayout()
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define OUI_IMPLEMENTATION
+#include "oui.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+    printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    failures++; } } while (0)
+
+static void check_rect(UIcontext *ctx, int item, int x, int y, int w, int h) {
+    UIrect rect = uiGetRect(ctx, item);
+    if ((rect.x != x) || (rect.y != y) || (rect.w != w) || (rect.h != h)) {
+        printf("item %d: got %d %d %d %d, expected %d %d %d %d\n",
+            item, rect.x, rect.y, rect.w, rect.h, x, y, w, h);
+        failures++;
+    }
+}
+
+// insert into and remove from a fixed size container that is not the root
+static void test_fixed_container(void) {
+    UIcontext *ctx = uiCreateContext(64, 0);
+    uiSetRetained(ctx, true);
+    uiBeginLayout(ctx);
+    int root = uiItem(ctx);
+    uiSetSize(ctx, root, 400, 300);
+    uiSetBox(ctx, root, UI_COLUMN|UI_START);
+    int header = uiInsert(ctx, root, uiItem(ctx));
+    uiSetSize(ctx, header, 400, 50);
+    int panel = uiInsert(ctx, root, uiItem(ctx));
+    uiSetSize(ctx, panel, 200, 100);
+    uiSetBox(ctx, panel, UI_ROW|UI_START);
+    int a = uiInsert(ctx, panel, uiItem(ctx));
+    uiSetSize(ctx, a, 40, 20);
+    uiEndLayout(ctx);
+    check_rect(ctx, panel, 100, 50, 200, 100);
+    check_rect(ctx, a, 100, 90, 40, 20);
+
+    int b = uiItem(ctx);
+    uiSetSize(ctx, b, 60, 30);
+    uiInsert(ctx, panel, b);
+    uiRelayout(ctx);
+    CHECK(uiFirstChild(ctx, panel) == a);
+    CHECK(uiNextSibling(ctx, a) == b);
+    check_rect(ctx, panel, 100, 50, 200, 100);
+    check_rect(ctx, a, 100, 90, 40, 20);
+    check_rect(ctx, b, 140, 85, 60, 30);
+
+    uiRemove(ctx, a);
+    uiRelayout(ctx);
+    CHECK(uiFirstChild(ctx, panel) == b);
+    CHECK(uiNextSibling(ctx, b) == -1);
+    check_rect(ctx, panel, 100, 50, 200, 100);
+    check_rect(ctx, b, 100, 85, 60, 30);
+    check_rect(ctx, header, 0, 0, 400, 50);
+
+    uiRemove(ctx, b);
+    uiRelayout(ctx);
+    CHECK(uiFirstChild(ctx, panel) == -1);
+    check_rect(ctx, panel, 100, 50, 200, 100);
+    uiDestroyContext(ctx);
+}
+
+// insert into an empty fixed size container
+static void test_empty_container(void) {
+    UIcontext *ctx = uiCreateContext(64, 0);
+    uiSetRetained(ctx, true);
+    uiBeginLayout(ctx);
+    int root = uiItem(ctx);
+    uiSetSize(ctx, root, 400, 300);
+    int panel = uiInsert(ctx, root, uiItem(ctx));
+    uiSetSize(ctx, panel, 200, 100);
+    uiSetBox(ctx, panel, UI_ROW);
+    uiEndLayout(ctx);
+    check_rect(ctx, panel, 100, 100, 200, 100);
+
+    int a = uiItem(ctx);
+    uiSetSize(ctx, a, 40, 20);
+    uiInsert(ctx, panel, a);
+    uiRelayout(ctx);
+    CHECK(uiFirstChild(ctx, panel) == a);
+    check_rect(ctx, a, 180, 140, 40, 20);
+    uiDestroyContext(ctx);
+}
+
+int main(void) {
+    test_fixed_container();
+    test_empty_container();
+    if (failures) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}